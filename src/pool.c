@@ -0,0 +1,472 @@
+/*
+** Work-stealing thread pool.
+**
+** Each worker owns a fixed size deque following the Chase-Lev algorithm. The owner pushes and
+** takes tasks at the bottom without taking any locks, while other workers steal from the top
+** using a single compare-and-swap. Tasks submitted from outside the pool go on a separate
+** injection queue protected by a mutex, since only the owning worker can push onto a deque.
+**
+** Workers that find no work spin briefly, in case a busy worker is about to split its task, and
+** then sleep on a condition variable until a task is pushed. A worker counts itself as a sleeper
+** before its last look for work, and a push looks for sleepers after it is made, with a full fence
+** on both sides, so either the sleeper sees the task or the push sees the sleeper and wakes it.
+*/
+
+/*
+** PREREQUISITES
+*/
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+#include "pool.h"
+
+/*
+** DEFINITIONS
+*/
+
+#define POOL_DEQUE_SIZE   1024   /* Must be a power of two */
+#define POOL_INJECT_SIZE  64     /* Initial size of the injection queue, grows as needed */
+#define POOL_IDLE_SPINS   64     /* Failed looks for work before an idle worker sleeps */
+
+struct _POOL_DEQUE_S
+{
+    atomic_long top;
+    char        pad[64];
+        /*
+        ** Keeps top and bottom on separate cache lines, as thieves write top
+        ** and the owner writes bottom.
+        */
+    atomic_long bottom;
+    POOL_TASK_S tasks[ POOL_DEQUE_SIZE ];
+};
+typedef struct _POOL_DEQUE_S POOL_DEQUE_S;
+
+struct _POOL_WORKER_S
+{
+    POOL_S *     ppool;
+    int          index;
+    unsigned int seed;   /* Used to pick a random victim when stealing */
+    pthread_t    thread;
+    POOL_DEQUE_S deque;
+};
+typedef struct _POOL_WORKER_S POOL_WORKER_S;
+
+struct _POOL_S
+{
+    int             threads;
+    POOL_WORKER_S * pworkers;
+
+    atomic_long     pending;
+        /*
+        ** Number of tasks submitted but not yet completed.
+        ** A task is only counted as complete after it returns, so any tasks it submits
+        ** are counted before the task itself is removed.
+        */
+    atomic_int      sleepers;
+    atomic_int      stop;
+
+    pthread_mutex_t lock;
+    pthread_cond_t  work_cond;
+    pthread_cond_t  done_cond;
+
+    POOL_TASK_S *   pinject;
+    size_t          inject_head;
+    size_t          inject_count;
+    size_t          inject_size;
+        /*
+        ** Ring buffer holding tasks submitted from outside the pool.
+        ** Protected by lock.
+        */
+};
+
+
+/*
+** LOCAL FUNCTIONS
+*/
+
+static int poolDequePush( POOL_DEQUE_S * pdeque, POOL_TASK_S task )
+{
+    long b = atomic_load_explicit( &pdeque->bottom, memory_order_relaxed );
+    long t = atomic_load_explicit( &pdeque->top,    memory_order_acquire );
+
+    if( b - t >= POOL_DEQUE_SIZE )
+        return 0;
+
+    pdeque->tasks[ b & (POOL_DEQUE_SIZE-1) ] = task;
+    atomic_store_explicit( &pdeque->bottom, b+1, memory_order_release );
+    return 1;
+}
+
+static int poolDequeTake( POOL_DEQUE_S * pdeque, POOL_TASK_S * ptask )
+{
+    /*
+    ** Removes a task from the bottom of the deque. Only called by the owner.
+    ** When a single task remains, the owner races the thieves for it using the same
+    ** compare-and-swap on top that the thieves use.
+    */
+    long b = atomic_load_explicit( &pdeque->bottom, memory_order_relaxed ) - 1;
+    atomic_store_explicit( &pdeque->bottom, b, memory_order_relaxed );
+    atomic_thread_fence( memory_order_seq_cst );
+    long t = atomic_load_explicit( &pdeque->top, memory_order_relaxed );
+
+    if( t > b )
+    {
+        atomic_store_explicit( &pdeque->bottom, b+1, memory_order_relaxed );
+        return 0;
+    }
+
+    *ptask = pdeque->tasks[ b & (POOL_DEQUE_SIZE-1) ];
+
+    if( t == b )
+    {
+        int won = atomic_compare_exchange_strong_explicit( &pdeque->top, &t, t+1,
+                                                           memory_order_seq_cst,
+                                                           memory_order_relaxed );
+        atomic_store_explicit( &pdeque->bottom, b+1, memory_order_relaxed );
+        return won;
+    }
+    return 1;
+}
+
+static int poolDequeSteal( POOL_DEQUE_S * pdeque, POOL_TASK_S * ptask )
+{
+    long t = atomic_load_explicit( &pdeque->top, memory_order_acquire );
+    atomic_thread_fence( memory_order_seq_cst );
+    long b = atomic_load_explicit( &pdeque->bottom, memory_order_acquire );
+
+    if( t >= b )
+        return 0;
+
+    *ptask = pdeque->tasks[ t & (POOL_DEQUE_SIZE-1) ];
+
+    return atomic_compare_exchange_strong_explicit( &pdeque->top, &t, t+1,
+                                                    memory_order_seq_cst,
+                                                    memory_order_relaxed );
+}
+
+static int poolDequeEmpty( POOL_DEQUE_S * pdeque )
+{
+    long t = atomic_load_explicit( &pdeque->top,    memory_order_acquire );
+    long b = atomic_load_explicit( &pdeque->bottom, memory_order_acquire );
+    return t >= b;
+}
+
+static int poolInjectTake( POOL_S * ppool, POOL_TASK_S * ptask )
+{
+    /*
+    ** Called with the pool lock held.
+    */
+    if( ppool->inject_count == 0 )
+        return 0;
+
+    *ptask = ppool->pinject[ ppool->inject_head ];
+    ppool->inject_head = (ppool->inject_head + 1) % ppool->inject_size;
+    ppool->inject_count--;
+    return 1;
+}
+
+static int poolInjectPush( POOL_S * ppool, POOL_TASK_S task )
+{
+    /*
+    ** Called with the pool lock held.
+    */
+    if( ppool->inject_count == ppool->inject_size )
+    {
+        size_t        size   = ppool->inject_size * 2;
+        POOL_TASK_S * ptasks = (POOL_TASK_S *)malloc( size * sizeof(POOL_TASK_S) );
+
+        if( ptasks == NULL )
+            return 0;
+
+        for( size_t i=0; i<ppool->inject_count; i++ )
+        {
+            ptasks[i] = ppool->pinject[ (ppool->inject_head + i) % ppool->inject_size ];
+        }
+        free( ppool->pinject );
+
+        ppool->pinject     = ptasks;
+        ppool->inject_head = 0;
+        ppool->inject_size = size;
+    }
+    ppool->pinject[ (ppool->inject_head + ppool->inject_count) % ppool->inject_size ] = task;
+    ppool->inject_count++;
+    return 1;
+}
+
+static int poolFindTask( POOL_WORKER_S * pworker, POOL_TASK_S * ptask )
+{
+    /*
+    ** Looks for work in order of preference. The worker's own deque first, then a steal
+    ** from the other workers starting at a random victim, and finally the injection queue.
+    */
+    POOL_S * ppool = pworker->ppool;
+
+    if( poolDequeTake( &pworker->deque, ptask ) )
+        return 1;
+
+    int victim = rand_r( &pworker->seed ) % ppool->threads;
+
+    for( int i=0; i<ppool->threads; i++ )
+    {
+        int w = (victim + i) % ppool->threads;
+
+        if( w != pworker->index && poolDequeSteal( &ppool->pworkers[w].deque, ptask ) )
+            return 1;
+    }
+
+    int found = 0;
+
+    pthread_mutex_lock( &ppool->lock );
+    found = poolInjectTake( ppool, ptask );
+    pthread_mutex_unlock( &ppool->lock );
+
+    return found;
+}
+
+static int poolHasWork( POOL_S * ppool )
+{
+    if( ppool->inject_count > 0 )
+        return 1;
+
+    for( int w=0; w<ppool->threads; w++ )
+    {
+        if( !poolDequeEmpty( &ppool->pworkers[w].deque ) )
+            return 1;
+    }
+    return 0;
+}
+
+static void poolTaskDone( POOL_S * ppool )
+{
+    if( atomic_fetch_sub( &ppool->pending, 1 ) == 1 )
+    {
+        pthread_mutex_lock( &ppool->lock );
+        pthread_cond_broadcast( &ppool->done_cond );
+        pthread_mutex_unlock( &ppool->lock );
+    }
+}
+
+static void poolWake( POOL_S * ppool )
+{
+    /*
+    ** Called after a task is pushed. The fence orders the push before the look at sleepers,
+    ** matching the one in poolWorkerMain.
+    */
+    atomic_thread_fence( memory_order_seq_cst );
+
+    if( atomic_load( &ppool->sleepers ) > 0 )
+    {
+        pthread_mutex_lock( &ppool->lock );
+        pthread_cond_signal( &ppool->work_cond );
+        pthread_mutex_unlock( &ppool->lock );
+    }
+}
+
+static void * poolWorkerMain( void * parg )
+{
+    POOL_WORKER_S * pworker = (POOL_WORKER_S *)parg;
+    POOL_S *        ppool   = pworker->ppool;
+    POOL_TASK_S     task;
+    int             spins   = 0;
+
+    while( !atomic_load( &ppool->stop ) )
+    {
+        if( poolFindTask( pworker, &task ) )
+        {
+            task.pfunc( ppool, pworker->index, task );
+            poolTaskDone( ppool );
+            spins = 0;
+            continue;
+        }
+
+        if( atomic_load( &ppool->pending ) > 0 && spins < POOL_IDLE_SPINS )
+        {
+            /*
+            ** Other workers are busy with tasks that may split soon. Stay awake a little
+            ** while, so the new work is stolen quickly.
+            */
+            spins++;
+            sched_yield();
+            continue;
+        }
+        spins = 0;
+
+        pthread_mutex_lock( &ppool->lock );
+        atomic_fetch_add( &ppool->sleepers, 1 );
+        atomic_thread_fence( memory_order_seq_cst );
+
+        if( !atomic_load( &ppool->stop ) && !poolHasWork( ppool ) )
+            pthread_cond_wait( &ppool->work_cond, &ppool->lock );
+
+        atomic_fetch_sub( &ppool->sleepers, 1 );
+        pthread_mutex_unlock( &ppool->lock );
+    }
+    return NULL;
+}
+
+
+/*
+** EXPORTED FUNCTIONS
+*/
+
+int poolCpuCount( void )
+{
+    long count = sysconf( _SC_NPROCESSORS_ONLN );
+
+    return count > 0 ? (int)count : 1;
+}
+
+POOL_S * poolCreate( int threads )
+{
+    if( threads <= 0 )
+        threads = poolCpuCount();
+
+    POOL_S * ppool = (POOL_S *)calloc( 1, sizeof(POOL_S) );
+    if( ppool == NULL )
+        return NULL;
+
+    ppool->threads     = threads;
+    ppool->pworkers    = (POOL_WORKER_S *)calloc( threads, sizeof(POOL_WORKER_S) );
+    ppool->pinject     = (POOL_TASK_S *)malloc( POOL_INJECT_SIZE * sizeof(POOL_TASK_S) );
+    ppool->inject_size = POOL_INJECT_SIZE;
+
+    if( ppool->pworkers == NULL || ppool->pinject == NULL )
+    {
+        free( ppool->pworkers );
+        free( ppool->pinject );
+        free( ppool );
+        return NULL;
+    }
+
+    atomic_init( &ppool->pending,  0 );
+    atomic_init( &ppool->sleepers, 0 );
+    atomic_init( &ppool->stop,     0 );
+
+    pthread_mutex_init( &ppool->lock, NULL );
+    pthread_cond_init ( &ppool->work_cond, NULL );
+    pthread_cond_init ( &ppool->done_cond, NULL );
+
+    int started = 0;
+
+    for( int w=0; w<threads; w++ )
+    {
+        POOL_WORKER_S * pworker = &ppool->pworkers[w];
+
+        pworker->ppool = ppool;
+        pworker->index = w;
+        pworker->seed  = (unsigned int)(w * 2654435761u + 1);
+
+        atomic_init( &pworker->deque.top,    0 );
+        atomic_init( &pworker->deque.bottom, 0 );
+    }
+    for( int w=0; w<threads; w++ )
+    {
+        if( pthread_create( &ppool->pworkers[w].thread, NULL, poolWorkerMain, &ppool->pworkers[w] ) != 0 )
+            break;
+        started++;
+    }
+
+    if( started < threads )
+    {
+        /*
+        ** Could not start every thread. Stop the ones that did start and fail.
+        */
+        pthread_mutex_lock( &ppool->lock );
+        atomic_store( &ppool->stop, 1 );
+        pthread_cond_broadcast( &ppool->work_cond );
+        pthread_mutex_unlock( &ppool->lock );
+
+        for( int w=0; w<started; w++ )
+        {
+            pthread_join( ppool->pworkers[w].thread, NULL );
+        }
+        pthread_mutex_destroy( &ppool->lock );
+        pthread_cond_destroy ( &ppool->work_cond );
+        pthread_cond_destroy ( &ppool->done_cond );
+
+        free( ppool->pworkers );
+        free( ppool->pinject );
+        free( ppool );
+        return NULL;
+    }
+    return ppool;
+}
+
+void poolDestroy( POOL_S * ppool )
+{
+    if( ppool == NULL )
+        return;
+
+    poolWait( ppool );
+
+    pthread_mutex_lock( &ppool->lock );
+    atomic_store( &ppool->stop, 1 );
+    pthread_cond_broadcast( &ppool->work_cond );
+    pthread_mutex_unlock( &ppool->lock );
+
+    for( int w=0; w<ppool->threads; w++ )
+    {
+        pthread_join( ppool->pworkers[w].thread, NULL );
+    }
+
+    pthread_mutex_destroy( &ppool->lock );
+    pthread_cond_destroy ( &ppool->work_cond );
+    pthread_cond_destroy ( &ppool->done_cond );
+
+    free( ppool->pworkers );
+    free( ppool->pinject );
+    free( ppool );
+}
+
+int poolThreads( POOL_S * ppool )
+{
+    return ppool->threads;
+}
+
+void poolSubmit( POOL_S * ppool, int worker, POOL_TASK_S task )
+{
+    atomic_fetch_add( &ppool->pending, 1 );
+
+    if( worker >= 0 && worker < ppool->threads )
+    {
+        if( !poolDequePush( &ppool->pworkers[worker].deque, task ) )
+        {
+            /*
+            ** The deque is full. Running the task here keeps the pool making
+            ** progress without having to grow the deque.
+            */
+            task.pfunc( ppool, worker, task );
+            poolTaskDone( ppool );
+            return;
+        }
+        poolWake( ppool );
+        return;
+    }
+
+    pthread_mutex_lock( &ppool->lock );
+    while( !poolInjectPush( ppool, task ) )
+    {
+        /*
+        ** Out of memory growing the injection queue. Wait for the workers to
+        ** drain some of it rather than losing the task.
+        */
+        pthread_mutex_unlock( &ppool->lock );
+        sched_yield();
+        pthread_mutex_lock( &ppool->lock );
+    }
+    pthread_cond_signal( &ppool->work_cond );
+    pthread_mutex_unlock( &ppool->lock );
+}
+
+void poolWait( POOL_S * ppool )
+{
+    pthread_mutex_lock( &ppool->lock );
+    while( atomic_load( &ppool->pending ) > 0 )
+    {
+        pthread_cond_wait( &ppool->done_cond, &ppool->lock );
+    }
+    pthread_mutex_unlock( &ppool->lock );
+}
@@ -0,0 +1,86 @@
+#ifndef __POOL_H__
+#define __POOL_H__
+/*
+** Implements a small work-stealing thread pool.
+**
+** Each worker thread owns a double ended queue of tasks. A worker pushes and pops tasks
+** at the bottom of its own queue, and when it runs out of work it steals tasks from the
+** top of another worker's queue. This keeps all of the workers busy even when the time
+** taken by each task varies a great deal, which is the case when solving sudoku boards.
+**
+** Tasks describe a range of work [lo, hi). A task that covers a large range would normally
+** split itself, pushing one half back onto its worker's queue with poolSubmit, so that idle
+** workers have something to steal.
+*/
+
+#include <stddef.h>
+
+/*
+** DEFINITIONS
+*/
+
+typedef struct _POOL_S POOL_S;
+        /*
+        ** Opaque thread pool.
+        */
+
+typedef struct _POOL_TASK_S POOL_TASK_S;
+
+typedef void POOL_TASK_FN(
+                POOL_S * ppool,
+                int worker,
+                        /*
+                        ** Index of the worker running the task, from 0 to poolThreads()-1.
+                        ** Useful for selecting per worker data, such as a solver context.
+                        */
+                POOL_TASK_S task
+                );
+
+struct _POOL_TASK_S
+{
+    POOL_TASK_FN * pfunc;
+    void *         parg;
+    size_t         lo;
+    size_t         hi;
+};
+
+
+/*
+** PUBLIC FUNCTIONS
+*/
+
+POOL_S * poolCreate ( int threads );
+void     poolDestroy( POOL_S * ppool );
+        /*
+        ** Creates and destroys a thread pool.
+        ** If threads is zero or less, one thread is started for each online processor.
+        ** poolCreate returns NULL if the pool could not be created.
+        ** poolDestroy waits for all submitted tasks to complete before stopping the threads.
+        */
+
+int poolThreads( POOL_S * ppool );
+        /*
+        ** Returns the number of worker threads in the pool.
+        */
+
+void poolSubmit( POOL_S * ppool, int worker, POOL_TASK_S task );
+        /*
+        ** Adds a task to the pool.
+        ** Pass the worker index given to a running task to push onto that worker's own queue.
+        ** Pass -1 when submitting from a thread that is not one of the pool's workers.
+        **
+        ** If a worker's queue is full, the task is run immediately on the calling worker.
+        */
+
+void poolWait( POOL_S * ppool );
+        /*
+        ** Blocks until every submitted task, including tasks submitted by other tasks,
+        ** has completed.
+        */
+
+int poolCpuCount( void );
+        /*
+        ** Returns the number of online processors, or 1 if it cannot be determined.
+        */
+
+#endif /* __POOL_H__ */
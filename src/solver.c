@@ -33,44 +33,217 @@
 ** - If a backtrack is performed on the initial candidate square, any pruning operations are undone, and the
 **   values that were removed from the candidates are restored.
 **
-** Using these two optimizations, a fairly quick solver is generated that can handle even hard problems in
-** a few seconds, and most easy problems in less than a second.
+** The third optimization is constraint propagation. After each value is placed, any value that is now
+** forced is placed as well, repeating until nothing more is forced.
+**
+**      . A naked single is a candidate square with only one candidate value left.
+**      . A hidden single is a value with only one candidate square left in a row, column or region.
+**
+** Propagation also notices dead ends early: a candidate square with no values left, or a unit with nowhere
+** left for one of its values, means the current path cannot lead to a solution. Every change is recorded on
+** the backtracking stack, so a backtrack undoes a placed value together with everything it forced.
+**
+** Finally, the search always branches on the candidate square with the fewest values left. Open candidate
+** squares are kept in buckets by their number of values, so this square is found in constant time.
+**
+** Using these optimizations, a fairly quick solver is generated that solves most boards with little or no
+** backtracking at all.
+**
+** All of the working state is kept in a solver context (SOLVER_CTX_S) rather than in globals. This
+** allows several boards to be solved at the same time, as long as each uses its own context.
 **
 */
 
 /*
 ** PREREQUISITES
 */
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
 #include "sw_dbg.h"
 
 #include "sudoku.h"
 #include "solver.h"
+#include "solver_bb.h"
+#include "solver_bits.h"
+#include "pool.h"
 
 /*
 ** DEFINITIONS
 */
 
-#define SOLVER_BACKTRACK_STACK_SIZE 34000
 #define SOLVER_CANDIDATE_ARRAY_SIZE 256
-#define SOLVER_SOLUTION_STACK_SIZE  256
+#define SOLVER_DECISION_STACK_SIZE  256
+#define SOLVER_UNIT_COUNT           48 /* Rows, columns and regions of the largest board */
+#define SOLVER_BUCKET_COUNT         17 /* Candidate squares can have from 0 to 16 values */
+
+#define SOLVER_BUCKET_HEAD(num) (SOLVER_CANDIDATE_ARRAY_SIZE + (num))
+
+enum
+{
+    SOLVER_SEARCH_NONE = 0, /* No enumeration started */
+    SOLVER_SEARCH_READY,    /* Started, no solution returned yet */
+    SOLVER_SEARCH_FOUND,    /* A solution has been returned, the next call resumes from it */
+    SOLVER_SEARCH_PAUSED,   /* A step ran out of time, the next call resumes where it stopped */
+    SOLVER_SEARCH_DONE      /* Every solution has been returned */
+};
+
+#define SOLVER_TRAIL_CHUNK_SHIFT 10
+#define SOLVER_TRAIL_CHUNK_SIZE  (1 << SOLVER_TRAIL_CHUNK_SHIFT)
+#define SOLVER_TRAIL_CHUNK_MASK  (SOLVER_TRAIL_CHUNK_SIZE - 1)
+        /*
+        ** The backtracking stack is allocated in chunks of this many entries, as it grows.
+        */
+
+#ifndef SOLVER_TRAIL_MAX_BYTES
+#define SOLVER_TRAIL_MAX_BYTES (SOLVER_CANDIDATE_ARRAY_SIZE * 17 * 4)
+#endif
+        /*
+        ** Hard limit on the memory used by the backtracking stack of one context. A solve that
+        ** would go over it stops with SOLVER_EXHAUSTED.
+        **
+        ** Along any one path of the search each cell is placed at most once, and each of its (at
+        ** most 16) values is pruned at most once, so the stack never needs more than 17 entries of
+        ** 4 bytes per cell. The default allows exactly that, with the last chunk cut short to fit.
+        ** Builds for small devices can define a lower limit, such as the size of a single chunk,
+        ** which is plenty for 9x9 boards.
+        */
+
+#define SOLVER_TRAIL_MAX_ENTRIES (SOLVER_TRAIL_MAX_BYTES / 4)
+#define SOLVER_TRAIL_MAX_CHUNKS  ((SOLVER_TRAIL_MAX_ENTRIES + SOLVER_TRAIL_CHUNK_SIZE - 1) / SOLVER_TRAIL_CHUNK_SIZE)
+
+#define SOLVER_NOGOOD_MAX_LITS 32
+#define SOLVER_NOGOOD_MAX      0x3FFF
+#define SOLVER_NOGOOD_NONE     (~0u)
+        /*
+        ** Longest nogood kept by learning, and most nogoods a store can hold. Longer nogoods are
+        ** still used to backjump, but are not kept.
+        */
+
+#define SOLVER_LIT(cell, vi) (((cell) << 4) | (vi))
+        /*
+        ** A literal is the placement of the value with bit vi in a cell.
+        */
+
+#define SOLVER_CAUSE_NONE   0xFFFF
+#define SOLVER_CAUSE_NOGOOD 0x4000
+#define SOLVER_CAUSE_LEVEL  0x8000
+        /*
+        ** Why a value was pruned from a cell, for learning. A value below SOLVER_CAUSE_NOGOOD is
+        ** the cell whose placement pruned it. SOLVER_CAUSE_NOGOOD plus an index is a stored nogood
+        ** that forced it out. SOLVER_CAUSE_LEVEL plus a depth covers deductions whose reasons are
+        ** not kept, by blaming every decision down to that depth. SOLVER_CAUSE_NONE is a value the
+        ** initial board ruled out.
+        */
+
+#define SOLVER_REASON_NAKED    0xFE
+#define SOLVER_REASON_DECISION 0xFF
+        /*
+        ** Why a cell was placed, for learning: a decision, a naked single, or else the unit in
+        ** which it was a hidden single.
+        */
+
+enum
+{
+    SOLVER_CONFLICT_CELL = 0, /* A cell with no values left */
+    SOLVER_CONFLICT_UNIT,     /* A value with nowhere left in a unit */
+    SOLVER_CONFLICT_NOGOOD    /* Every placement of a stored nogood */
+};
+
+#define SOLVER_BATCH_GRAIN 4
+        /*
+        ** A batch task covering more boards than this is split in two, with one half
+        ** left for other workers to steal.
+        */
+
+#define SOLVER_PARALLEL_SPLIT_DEPTH 6
+#define SOLVER_PARALLEL_MAX_TASKS   1024
+        /*
+        ** A parallel search splits the tree this many decisions deep, giving up to a few
+        ** dozen subproblems per board for the workers to share. Splitting stops early if the
+        ** snapshot array fills up.
+        */
+
+#define SOLVER_COUNT_SUBTREES     256
+#define SOLVER_COUNT_MAX_SUBTREES 4096
+        /*
+        ** A parallel count splits the tree level by level until there are at least
+        ** SOLVER_COUNT_SUBTREES subtrees, unless the next level could need more than
+        ** SOLVER_COUNT_MAX_SUBTREES. The split depends only on the board, never on the number
+        ** of threads, so the same subtrees are counted however many threads there are.
+        */
+
+#define SOLVER_POLL_INTERVAL      256
+#define SOLVER_STEP_POLL_INTERVAL 16
+        /*
+        ** A search with limits only checks them once every 256 values tried, so reading the clock
+        ** and the cancellation tokens costs next to nothing. solverStep checks more often, since
+        ** its budgets are a fraction of a frame.
+        */
+
+#define SOLVER_POLL_RESTART (-1)
+        /*
+        ** Returned by solverPoll when the search is due to restart. Never returned to callers.
+        */
+
+#define SOLVER_RESTART_SCAN 8
+        /*
+        ** With restarts on, the cell to branch on is the one with the most conflicts among this
+        ** many cells with the fewest values, ties broken at random.
+        */
+
+#ifndef SOLVER_STATS
+#define SOLVER_STATS 1
+#endif
+        /*
+        ** Builds that define SOLVER_STATS as 0 leave out every statistics counter and timer, so
+        ** the search runs exactly as it would without them. solverCtxStats then reports zeros.
+        */
+
+#if SOLVER_STATS
+    #define SOLVER_STAT_ADD(pctx, field, amount)  ((pctx)->stats.field += (amount))
+    #define SOLVER_STAT_MAX(pctx, field, value)   if( (value) > (pctx)->stats.field ) (pctx)->stats.field = (value)
+    #define SOLVER_STAT_NOW()                     solverNowNs()
+    #define SOLVER_STAT_TIME(pctx, field, start)  ((pctx)->stats.field += solverNowNs() - (start))
+#else
+    #define SOLVER_STAT_ADD(pctx, field, amount)  ((void)0)
+    #define SOLVER_STAT_MAX(pctx, field, value)   ((void)0)
+    #define SOLVER_STAT_NOW()                     0
+    #define SOLVER_STAT_TIME(pctx, field, start)  ((void)(start))
+#endif
+
+#ifndef SOLVER_TRACE
+#define SOLVER_TRACE 1
+#endif
+        /*
+        ** Builds that define SOLVER_TRACE as 0 leave out the trace recorder. Otherwise, a search
+        ** without a trace attached pays for one test of a pointer per event.
+        */
+
+#if SOLVER_TRACE
+    #define SOLVER_TRACE_EVENT(pctx, type, cell, value) \
+        if( (pctx)->ptrace != NULL ) solverTraceEmit( (pctx)->ptrace, (type), (cell), (value) )
+#else
+    #define SOLVER_TRACE_EVENT(pctx, type, cell, value) ((void)0)
+#endif
+
+#define SOLVER_TRACE_MIN_CAPACITY 4096
 
 struct _SOLVER_GAMEBOARD_S
 {
     /*
     ** Stores a representation of the initial gameboard.
-    ** Used when determining if a possible candidate value is valid.
-    **
-    ** The gameboard is essentially stored twice, one in row-major and another in column-major order.
-    ** This potentially can reduce the number of cache-misses when comparing values. A third array is also
-    ** maintained to store the initial values for each region.
+    ** Used to tell the initial values apart from the values placed by the solver.
     **
     ** Values are stored as a bitmask, where each bit represents a single value. So, a value with a 1 in bit
     ** 5 represents the value of 5. Each entry is 16 bits, so this means it can store values from 1 to 16, which
     ** supports sudoku boards up to n = 4.
     */
     unsigned short rows[16][16];
-    unsigned short cols[16][16];
-    unsigned short regs[16];
 };
 typedef struct _SOLVER_GAMEBOARD_S SOLVER_GAMEBOARD_S;
 
@@ -78,393 +251,2889 @@ struct _SOLVER_CANDITATE_S
 {
     /*
     ** Structure representing a single entry in the candidate array.
-    ** Each candidate represents a single candidate square from the gameboard. It stores its location
+    ** Each candidate represents a single square from the gameboard. It stores its location
     ** in the gameboard, as well as the number and possible candidate values.
-    **
-    ** A bitfield is used as an optimizing step.
     */
-    unsigned int row : 4;
-    unsigned int col : 4;
-    unsigned int reg : 4;
-    unsigned int num : 4;
-    unsigned int val : 16;
+    unsigned char  row;
+    unsigned char  col;
+    unsigned char  reg;
+    unsigned char  num; /* Number of values in val, up to 16 */
+    unsigned short val;
         /*
         ** The list of possible candidate values.
         ** The candidate values are stored as a bitfield, where if a 1 appears at a particular position, that
         ** value is a candidate. So, for example, if this value was 0000100010010000, ones appear in positions 5, 8 and
         ** 12, so 5, 8 and 12 are possible candidate values for this candidate square.
         */
+    unsigned short set;
+        /*
+        ** The value placed in the square, as a bitmask, or 0 while the square is still open.
+        */
 };
 typedef struct _SOLVER_CANDITATE_S SOLVER_CANDITATE_S;
 
-union _SOLVER_BACKTRACK_S
+struct _SOLVER_BACKTRACK_S
 {
     /*
     ** Represents a single entry on the backtracking stack.
-    ** Each entry stores a 'pruning' operation that was performed.
-    ** It can also store other information which is discussed with the backtrack stack.
+    ** Each entry records one change made to the candidate array, either a value 'pruned' from a
+    ** candidate square or a value placed in one. Placements have SOLVER_BACKTRACK_ASSIGN set in row.
     */
-    struct
-    {
-        unsigned int row : 16; /* The row from the candidate array where this pruning operation occured. */
-        unsigned int val : 16; /* The value pruned. Again, the value is stored as a bitmask. */
-    } bt;
-    unsigned int item;
-    unsigned int count;
+    unsigned short row; /* The row from the candidate array that was changed */
+    unsigned short val; /* The value pruned or placed, stored as a bitmask */
+};
+typedef struct _SOLVER_BACKTRACK_S SOLVER_BACKTRACK_S;
+
+#define SOLVER_BACKTRACK_ASSIGN 0x8000
+
+struct _SOLVER_DECISION_S
+{
+    /*
+    ** A single branch point of the search.
+    ** Records the candidate square branched on, the values that have not been tried yet, and the
+    ** height of the backtracking stack before the first value was placed. Undoing back to that
+    ** height removes the value and everything propagation deduced from it.
+    **
+    ** A decision can instead branch on where a value goes in a unit. Then unit holds the unit and
+    ** the value, rem holds the cells of the unit not tried yet, and cand is the cell being tried.
+    */
+    unsigned short cand;
+    unsigned short rem;
+    unsigned int   mark;
+    unsigned short unit; /* SOLVER_DECISION_CELL, or (unit << 4) | value index */
+};
+typedef struct _SOLVER_DECISION_S SOLVER_DECISION_S;
+
+#define SOLVER_DECISION_CELL 0xFFFF
+
+struct _SOLVER_EDIT_S
+{
+    /*
+    ** A board being edited with solverAssign and solverUnassign.
+    ** Kept apart from the search state, so a search from the edited board leaves it untouched.
+    ** Every edit only updates the edited cell and its peers.
+    */
+    SUDOKU_S       board;
+    unsigned short cand [ SOLVER_CANDIDATE_ARRAY_SIZE ];
+        /*
+        ** The values still possible in each empty cell, as a bitmask. Zero for filled cells.
+        */
+    unsigned char  count[ SOLVER_UNIT_COUNT ][ 16 ];
+        /*
+        ** The number of times each value appears in each unit.
+        */
+    unsigned short used [ SOLVER_UNIT_COUNT ];
+        /*
+        ** The values that appear in each unit.
+        */
+    unsigned int   conflicts; /* Extra copies of values in units, over all units */
+    unsigned int   blocked;   /* Empty cells with no values left */
+};
+typedef struct _SOLVER_EDIT_S SOLVER_EDIT_S;
+
+struct _SOLVER_TRACE_S
+{
+    /*
+    ** A recorded search. Each event is one header byte holding the event type and value,
+    ** followed by a varint: the change in cell from the previous event, zigzag encoded, or the
+    ** depth for a backtrack. Events mostly touch cells close to the one before, so nearly every
+    ** event takes two bytes.
+    */
+    unsigned char *    data;
+    size_t             size;
+    size_t             capacity;
+    size_t             max_bytes;
+    unsigned long long events;
+    unsigned int       cell;      /* Cell of the last event, which the next one is relative to */
+    int                truncated; /* Set once an event did not fit */
+};
+
+#define SOLVER_TABLE_WAYS 4
+
+struct _SOLVER_TABLE_S
+{
+    /*
+    ** Hashes of board states known to have no solution, in buckets of SOLVER_TABLE_WAYS slots.
+    ** Each slot is a single atomic word holding the hash with its lowest bit set, so an empty
+    ** slot reads as zero and a slot is never seen half written. Searches in other threads can
+    ** use the table at the same time without any locks. A store may overwrite an entry another
+    ** thread has just written. That only means the same subtree might be searched again later.
+    */
+    _Atomic uint64_t * slot;
+    size_t             mask; /* Buckets - 1, the bucket count being a power of two */
+};
+
+#define SOLVER_DLX_MAX_COLS  (4 * 256)
+#define SOLVER_DLX_MAX_ROWS  (16 * 256)
+#define SOLVER_DLX_MAX_NODES (1 + SOLVER_DLX_MAX_COLS + (4 * SOLVER_DLX_MAX_ROWS))
+
+struct _SOLVER_DLX_S
+{
+    /*
+    ** Node arena for the dancing links backend.
+    ** Node 0 is the root, nodes 1 to the number of columns are the column headers, and the
+    ** remaining nodes belong to rows, four to a row. Links are stored as node indices in
+    ** separate arrays, which keeps the arena compact and free of pointers.
+    **
+    ** The arena is sized for the largest board (n = 4) and allocated the first time a context
+    ** uses this backend. It is kept with the context after that, so later solves reuse it.
+    */
+    unsigned short l[ SOLVER_DLX_MAX_NODES ];
+    unsigned short r[ SOLVER_DLX_MAX_NODES ];
+    unsigned short u[ SOLVER_DLX_MAX_NODES ];
+    unsigned short d[ SOLVER_DLX_MAX_NODES ];
+    unsigned short c[ SOLVER_DLX_MAX_NODES ]; /* Column header of each node */
+    unsigned short p[ SOLVER_DLX_MAX_NODES ];
+        /*
+        ** The placement represented by a row node, stored as (cell * 16) + (value - 1).
+        */
+    
+    unsigned short size  [ SOLVER_DLX_MAX_COLS + 1 ]; /* Number of rows in each column */
+    unsigned short col_of[ SOLVER_DLX_MAX_COLS ];
+        /*
+        ** Maps a constraint to its column header, or 0 if the constraint is already
+        ** satisfied by the initial board and has no column.
+        */
+    unsigned short choice[ 256 ];
+        /*
+        ** The row node chosen at each level of the search.
+        */
+    unsigned int node_count;
+};
+typedef struct _SOLVER_DLX_S SOLVER_DLX_S;
+
+
+struct _SOLVER_NOGOOD_S
+{
+    /*
+    ** A set of placements that cannot all hold in any solution. The first two literals are
+    ** watched: the nogood is only looked at when one of them is placed.
+    */
+    unsigned short lit[ SOLVER_NOGOOD_MAX_LITS ];
+    unsigned int   count;
+    unsigned int   watch_next[ 2 ]; /* Next nogood watching lit[0] and lit[1] */
+    unsigned int   lru_prev;
+    unsigned int   lru_next;
+};
+typedef struct _SOLVER_NOGOOD_S SOLVER_NOGOOD_S;
+
+struct _SOLVER_LEARN_S
+{
+    /*
+    ** Nogoods learned from the conflicts of one solve, kept in least recently used order. A
+    ** nogood is used whenever it forces a value out of a cell or causes a conflict, and once the
+    ** store is full a new nogood replaces the one used longest ago.
+    */
+    unsigned int    capacity;
+    unsigned int    used;
+    unsigned int    lru_head; /* Most recently used */
+    unsigned int    lru_tail;
+    unsigned int    watch_head[ SOLVER_CANDIDATE_ARRAY_SIZE * 16 ]; /* First nogood watching each literal */
+    unsigned char   seen      [ SOLVER_CANDIDATE_ARRAY_SIZE ];      /* Cells in the nogood being built */
+    SOLVER_NOGOOD_S nogood[];
+};
+typedef struct _SOLVER_LEARN_S SOLVER_LEARN_S;
+
+
+struct _SOLVER_CTX_S
+{
+    /*
+    ** Holds the complete working state of a single solve.
+    ** Every function in the solver operates on one of these, so separate contexts can be used to
+    ** solve separate boards at the same time, for example one context per thread.
+    **
+    ** A context is sized for the largest supported board, apart from the backtracking stack,
+    ** which grows as needed up to SOLVER_TRAIL_MAX_BYTES.
+    */
+    SOLVER_GAMEBOARD_S gameboard;
+    
+    SOLVER_CANDITATE_S candidate_array[ SOLVER_CANDIDATE_ARRAY_SIZE ];
+        /*
+        ** One entry for every cell of the board, indexed by (row * nn) + col. Cells holding an
+        ** initial value are set from the start and are never open.
+        */
+    SOLVER_BACKTRACK_S * backtrack_chunk[ SOLVER_TRAIL_MAX_CHUNKS ];
+        /*
+        ** The backtracking stack stores every change made to the candidate array, in order.
+        ** Undoing the changes from the top of the stack down to an earlier height restores the
+        ** candidate array to exactly the state it was in at that height.
+        **
+        ** Entry i is in chunk i >> SOLVER_TRAIL_CHUNK_SHIFT. Chunks are allocated the first time
+        ** the stack reaches them and kept until the context is destroyed, so a context that has
+        ** solved a board of some size solves the next one without allocating.
+        */
+    unsigned int backtrack_stack_size;  /* Entries in the allocated chunks */
+    unsigned int backtrack_stack_peak;  /* Highest the stack has been since the context was reset */
+    int          exhausted;             /* Set when the stack could not grow */
+    
+    SOLVER_DECISION_S decision_stack[ SOLVER_DECISION_STACK_SIZE ];
+        /*
+        ** The decision stack stores the branch points of the current path through the search.
+        ** Values placed by propagation are not decisions, and only appear on the backtracking stack.
+        ** Each decision is on an open cell that is placed on the way down, so there can never be
+        ** more decisions than cells.
+        */
+    
+    unsigned short unit_used[ SOLVER_UNIT_COUNT ];
+        /*
+        ** The values placed in each unit so far, including the values on the initial board.
+        ** Units are numbered rows first, then columns, then regions, so column c is unit nn + c
+        ** and region r is unit (2 * nn) + r.
+        */
+    
+    unsigned short unit_where[ SOLVER_UNIT_COUNT ][ 16 ];
+        /*
+        ** The open cells of each unit where each value can still go, with bit i standing for the
+        ** i-th cell of the unit. Kept up to date by every prune, placement and undo, so the search
+        ** can find the value with the fewest places left as cheaply as the cell with the fewest
+        ** values.
+        */
+    
+    unsigned char  queue [ SOLVER_CANDIDATE_ARRAY_SIZE ];
+    unsigned char  queued[ SOLVER_CANDIDATE_ARRAY_SIZE ];
+    unsigned int   queue_head;
+    unsigned int   queue_tail;
+    uint64_t       unit_dirty;
+        /*
+        ** Propagation work still to do. The queue holds candidate squares that have been pruned
+        ** down to a single value, and unit_dirty has a bit set for every unit that has changed
+        ** since it was last checked for hidden singles.
+        */
+    
+    unsigned short bucket_next[ SOLVER_CANDIDATE_ARRAY_SIZE + SOLVER_BUCKET_COUNT ];
+    unsigned short bucket_prev[ SOLVER_CANDIDATE_ARRAY_SIZE + SOLVER_BUCKET_COUNT ];
+    uint32_t       bucket_mask;
+        /*
+        ** The open candidate squares, bucketed by their number of candidate values.
+        ** Each bucket is a circular doubly linked list whose head is the extra entry at
+        ** SOLVER_BUCKET_HEAD(num), and bucket_mask has a bit set for each bucket that is not empty.
+        ** Moving a square between buckets as values are pruned and restored is constant time, and
+        ** so is finding the square with the fewest values left.
+        */
+    
+    unsigned int backtrack_stack_top;
+    unsigned int decision_stack_top;
+    
+    int search_state; /* One of the SOLVER_SEARCH values, used by solverNext */
+    
+    const atomic_int * pstop;
+        /*
+        ** If pstop is set, the search gives up with SOLVER_NO_SOLUTION once it becomes non-zero.
+        ** Used to stop the other workers once one has found a solution.
+        */
+    const atomic_int * pcancel;     /* The caller's cancellation token, or NULL */
+    unsigned long long node_limit;  /* Values tried before the search times out, or 0 */
+    unsigned long long deadline;    /* Monotonic clock time at which the search times out, or 0 */
+    unsigned long long poll_nodes;  /* Values tried since the limits were set */
+    unsigned int       poll_interval;
+    unsigned long long poll_next;
+        /*
+        ** The limits are checked once poll_nodes reaches poll_next. Without any limits poll_next
+        ** is never reached, so the search pays for one comparison per value tried.
+        */
+    
+    int          level;     /* The SOLVER_LEVEL of propagation */
+    unsigned int probe_max; /* Decisions with at most this many values are probed first */
+    unsigned int learn_max; /* Nogoods kept by learning, or 0 */
+    
+    unsigned int       restart_base;  /* Values tried per unit of the restart schedule, or 0 */
+    unsigned int       restart_count; /* Restarts so far, which picks the next Luby term */
+    unsigned long long restart_at;    /* poll_nodes at which to restart next, or 0 */
+    uint64_t           rng;           /* xorshift state, seeded from SOLVER_OPTS_S.seed */
+    unsigned int       conflicts[ SOLVER_CANDIDATE_ARRAY_SIZE ];
+        /*
+        ** Dead ends met at each cell since the solve started. Kept across restarts, so each
+        ** restart branches first on the cells that caused the most trouble so far.
+        */
+    
+    unsigned short prune_cause  [ SOLVER_CANDIDATE_ARRAY_SIZE ][ 16 ];
+    unsigned short assign_level [ SOLVER_CANDIDATE_ARRAY_SIZE ];
+    unsigned int   assign_pos   [ SOLVER_CANDIDATE_ARRAY_SIZE ];
+    unsigned char  assign_reason[ SOLVER_CANDIDATE_ARRAY_SIZE ];
+        /*
+        ** How each value came to be pruned, and the depth, backtracking stack height and reason of
+        ** each placement. Learning follows these back from a conflict to the decisions behind it.
+        */
+    unsigned int conflict_kind; /* The SOLVER_CONFLICT of the last failure, with its cell or unit */
+    unsigned int conflict_at;
+    unsigned int conflict_vi;   /* For a unit, the value's bit. For a nogood, its index */
+    
+    int              learning; /* Set for a search that learns nogoods */
+    SOLVER_LEARN_S * plearn;   /* Allocated on first use of learning */
+    
+    unsigned int candidate_count; /* Entries used in the candidate array, one per cell */
+    
+    unsigned int n;
+    unsigned int nn;
+    
+    SOLVER_DLX_S * pdlx; /* Allocated on first use of the dancing links backend */
+    
+    SOLVER_EDIT_S edit;
+    
+    SOLVER_STATS_S stats; /* Cleared at the start of each solve, count or enumeration */
+    
+    SOLVER_TRACE_S * ptrace; /* Receives the events of the search, if set */
+    
+    uint64_t         hash;   /* Zobrist hash of the values placed so far, givens included */
+    int              found;  /* Set once the search has returned a solution */
+    SOLVER_TABLE_S * ptable;
+        /*
+        ** If set, board states the search has found to have no solution are stored here, and any
+        ** state found in it is backtracked from at once. Only states searched in full before the
+        ** first solution are stored, since later ones may have had solutions in them.
+        */
+};
+
+
+struct _SOLVER_BATCH_S
+{
+    const SUDOKU_S * psudoku;
+    SUDOKU_S *       solution;
+    int *            status;
+    SOLVER_STATS_S * stats;
+    SOLVER_CTX_S **  ppctx;    /* One context for each worker */
+    int *            psolved;  /* Boards solved by each worker */
+    SOLVER_OPTS_S    opts;     /* Options for each board, always on one thread */
+};
+typedef struct _SOLVER_BATCH_S SOLVER_BATCH_S;
+
+struct _SOLVER_PARALLEL_S
+{
+    /*
+    ** Shared state of a parallel search of a single board.
+    **
+    ** Each subproblem is a snapshot of the board with the values placed on the way down to it
+    ** filled in. Workers rebuild their own context from a snapshot, so the only things they
+    ** share are the snapshots, which are never changed once written, and the fields below.
+    */
+    SUDOKU_S *      snapshot;       /* SOLVER_PARALLEL_MAX_TASKS entries */
+    atomic_uint     snapshot_count;
+    SOLVER_CTX_S ** ppctx;          /* One context for each worker */
+    atomic_int      cancel;         /* Set once a solution has been found */
+    atomic_int      found;          /* Set by the worker that claims the result */
+    atomic_int      exhausted;      /* Set if any worker ran out of room */
+    atomic_int      stopped;        /* SOLVER_TIMEOUT or SOLVER_CANCELLED if a worker hit a limit */
+    SUDOKU_S        result;
+};
+typedef struct _SOLVER_PARALLEL_S SOLVER_PARALLEL_S;
 
+struct _SOLVER_COUNT_S
+{
+    /*
+    ** Shared state of a parallel count. Each worker only adds to its own counter, and the
+    ** counters are added up once every subtree is done.
+    */
+    const SUDOKU_S *     psubtree;
+    SOLVER_CTX_S **      ppctx;     /* One context for each worker */
+    unsigned long long * pcount;    /* One counter for each worker */
+    
+    pthread_mutex_t      mutex;     /* Guards the fields below */
+    int                  exhausted; /* Set if any subtree could not be counted in full */
+    size_t               done;
+    size_t               total;
+    unsigned long long   found;
+    SOLVER_PROGRESS_FN * pfunc;
+    void *               parg;
 };
-typedef union _SOLVER_BACKTRACK_S SOLVER_BACKTRACK_S;
+typedef struct _SOLVER_COUNT_S SOLVER_COUNT_S;
 
 
 /*
 ** LOCAL VARIABLES
 */
 
-static SOLVER_GAMEBOARD_S solver_gameboard;
-
-static SOLVER_CANDITATE_S solver_candidate_array[ SOLVER_CANDIDATE_ARRAY_SIZE ];
-static SOLVER_BACKTRACK_S solver_backtrack_stack[ SOLVER_BACKTRACK_STACK_SIZE ];
+static SOLVER_CTX_S solver_ctx = { .poll_interval = SOLVER_POLL_INTERVAL, .poll_next = ~0ull };
         /*
-        ** The backtracking stack stores backtracking operations to undo any pruning operations
-        ** performed earlier. As pruning operations are performed, the undo operations are stored on the
-        ** backtracking stack. Immediately following the operations, the number of operations are pushed,
-        ** and the current candidate bitfield is also stored.
+        ** Context used by solverSolve, which keeps the original single threaded interface.
+        ** It never goes through solverCtxReset, so the fields that are not zero without limits are
+        ** set here.
         */
 
-static SOLVER_CANDITATE_S solver_solution_stack [ SOLVER_SOLUTION_STACK_SIZE  ];
+static pthread_once_t solver_once = PTHREAD_ONCE_INIT;
         /*
-        ** The solution stack stores the currently working solution.
-        ** As new candidate values are tried, these are added to the solution stack.
-        ** When a backtracking operation is performed, possible solutions are removed.
+        ** Guards the building of the engine tables, which are read only after that.
         */
 
-static unsigned int solver_backtrack_stack_top;
-static unsigned int solver_solution_stack_top;
-
-static unsigned int solver_candidate_current;
-static unsigned int solver_candidate_count;
+static unsigned char solver_units[ 5 ][ SOLVER_CANDIDATE_ARRAY_SIZE ][ 3 ];
+static unsigned short solver_unit_slot[ 5 ][ SOLVER_CANDIDATE_ARRAY_SIZE ][ 3 ];
+static unsigned char solver_unit_cells[ 5 ][ SOLVER_UNIT_COUNT ][ 16 ];
+        /*
+        ** For each box size, the row, column and region unit of each cell, the bit of the cell
+        ** in the unit_where masks of each, and the cells in each unit. Built by the engine of each
+        ** size, and shared with the code here that works for any size, so neither ever divides to
+        ** find a region.
+        */
 
-static unsigned int solver_n;
-static unsigned int solver_nn;
+static uint64_t solver_zobrist[ SOLVER_CANDIDATE_ARRAY_SIZE ][ 16 ];
+static uint64_t solver_zobrist_size[ 5 ];
+        /*
+        ** Random keys for each value in each cell, and for each box size. The hash of a board
+        ** state is the key of its box size with the keys of every value placed xored in, so it can
+        ** be kept up to date with one xor per placement and undo.
+        */
 
 
 /*
 ** LOCAL FUNCTIONS
 */
 
-void solverSetGameboard( const SUDOKU_S * psudoku )
+static inline unsigned long long solverNowNs( void )
 {
-    solver_n  = psudoku->n;
-    solver_nn = solver_n * solver_n;
+    struct timespec ts;
     
-    for( unsigned int reg=0; reg<solver_nn; reg++ )
-    {
-        solver_gameboard.regs[reg] = 0;
-    }
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    
+    return ((unsigned long long)ts.tv_sec * 1000000000ull) + (unsigned long long)ts.tv_nsec;
+}
+
+#if SOLVER_TRACE
+static int solverTraceReserve( SOLVER_TRACE_S * ptrace, size_t bytes )
+{
+    /*
+    ** Makes room for bytes more bytes, doubling the buffer as needed. Returns zero, and marks the
+    ** trace as truncated, if that would go over its limit.
+    */
+    if( ptrace->truncated )
+        return 0;
     
-    for( unsigned int row=0; row<solver_nn; row++ )
+    if( ptrace->size + bytes > ptrace->capacity )
     {
-        for( unsigned int col=0; col<solver_nn; col++ )
+        size_t capacity = ptrace->capacity ? ptrace->capacity * 2 : SOLVER_TRACE_MIN_CAPACITY;
+        
+        if( capacity > ptrace->max_bytes )
+            capacity = ptrace->max_bytes;
+        
+        unsigned char * data = NULL;
+        
+        if( ptrace->size + bytes <= capacity )
+            data = (unsigned char *)realloc( ptrace->data, capacity );
+        
+        if( data == NULL )
         {
-            unsigned int val = 0;
-            unsigned int reg = ((row / solver_n) * solver_n) + (col / solver_n);
-            unsigned int bv  = psudoku->board[row][col];
-            
-            if( bv > 0 ) {
-                /*
-                ** Non-zero board entries are valid values.
-                ** Determine the bitfield representation for the value, which moves the 1
-                ** bit to the ordered position representing the value.
-                */
-                val = 1 << (bv - 1);
-            }
-    
-            solver_gameboard.rows[row][col] = val;
-            solver_gameboard.cols[col][row] = val;
-            solver_gameboard.regs[reg]     |= val;
+            ptrace->truncated = 1;
+            return 0;
         }
+        ptrace->data     = data;
+        ptrace->capacity = capacity;
     }
+    return 1;
 }
 
-int solverRowHasValue( unsigned int row, unsigned int cand_mask )
+static void solverTraceEmit( SOLVER_TRACE_S * ptrace, unsigned int type, unsigned int cell, unsigned int value )
 {
-    for( unsigned int col=0; col<solver_nn; col++ )
+    /*
+    ** Appends one event. value is a bitmask for placements and prunes, and cell is the depth for
+    ** backtracks.
+    */
+    unsigned int varint;
+    
+    if( !solverTraceReserve( ptrace, 4 ) )
+        return;
+    
+    if( type == SOLVER_TRACE_BACKTRACK )
     {
-        if( solver_gameboard.rows[row][col] & cand_mask )
-            return 1;
+        ptrace->data[ptrace->size++] = type << 4;
+        varint = cell;
     }
-    return 0;
-}
-
-int solverColHasValue( unsigned int col, unsigned int cand_mask )
-{
-    for( unsigned int row=0; row<solver_nn; row++ )
+    else
     {
-        if( solver_gameboard.cols[col][row] & cand_mask )
-            return 1;
+        int delta = (int)cell - (int)ptrace->cell;
+        
+        ptrace->data[ptrace->size++] = (type << 4) | SOLVER_CTZ32( value );
+        ptrace->cell = cell;
+        varint = (delta >= 0) ? ((unsigned int)delta << 1) : (((unsigned int)-delta << 1) - 1);
     }
-    return 0;
-}
-
-int solverRegHasValue( unsigned int reg, unsigned int cand_mask )
-{
-    return solver_gameboard.regs[reg] & cand_mask;
-}
-
-void solverGenerateCandiates( const SUDOKU_S * psudoku )
-{
-    solver_candidate_count = 0;
     
-    for( unsigned int row=0; row<solver_nn; row++ )
+    while( varint >= 0x80 )
     {
-        for( unsigned int col=0; col<solver_nn; col++ )
-        {
-            unsigned int reg = ((row / solver_n) * solver_n) + (col / solver_n);
-            
-            if( psudoku->board[row][col] == 0 )
-            {
-                solver_candidate_array[solver_candidate_count].row = row;
-                solver_candidate_array[solver_candidate_count].col = col;
-                solver_candidate_array[solver_candidate_count].reg = reg;
-                solver_candidate_array[solver_candidate_count].num = 0;
-                solver_candidate_array[solver_candidate_count].val = 0;
-                
-                for( unsigned int cand_shift=0; cand_shift<solver_nn; cand_shift++ ) {
-                    /*
-                    ** Generates the list of possible candidate values for this candidate square.
-                    ** Uses the fact that the initial gameboard has already been setup earlier using bitfield values.
-                    **
-                    ** Each possible candidate value is tried by first generating the bitfield representation of
-                    ** that value and seeing if it is a valid value, and if so, adding it to the list of candidates.
-                    */
-                    unsigned int candidate = 1 << cand_shift;
-                    
-                    if( solverRowHasValue(row, candidate) == 0 &&
-                        solverColHasValue(col, candidate) == 0 &&
-                        solverRegHasValue(reg, candidate) == 0 )
-                    {
-                        solver_candidate_array[solver_candidate_count].val |= candidate;
-                        solver_candidate_array[solver_candidate_count].num++;
-                    }
-                }
-                
-                solver_candidate_count++;
-            }
-        }
+        ptrace->data[ptrace->size++] = (varint & 0x7F) | 0x80;
+        varint >>= 7;
     }
+    ptrace->data[ptrace->size++] = varint;
+    ptrace->events++;
 }
+#endif
 
-void solverSortCandidates( void ) {
+static unsigned long long solverLuby( unsigned int i )
+{
     /*
-    ** Sorts the array of candidates by the number of possible candidate values.
-    ** Uses a basic insertion sort.
+    ** Returns term i of the Luby sequence 1 1 2 1 1 2 4 1 1 2 1 1 2 4 8 ..., counting from 0.
     */
-    unsigned int i = 1;
-    unsigned int j;
+    unsigned int size = 1;
+    unsigned int seq  = 0;
     
-    while( i < solver_candidate_count )
+    while( size < i + 1 )
     {
-        j = i;
-        while( j > 0 && solver_candidate_array[j-1].num > solver_candidate_array[j].num )
-        {
-            SOLVER_CANDITATE_S temp = solver_candidate_array[j];
-            solver_candidate_array[j] = solver_candidate_array[j-1];
-            solver_candidate_array[j-1] = temp;
-            j--;
-        }
-        i++;
+        seq++;
+        size = (2 * size) + 1;
+    }
+    while( size - 1 != i )
+    {
+        size = (size - 1) >> 1;
+        seq--;
+        i %= size;
     }
+    return 1ull << seq;
 }
 
-void solverPrune(
-    unsigned int row,
-    unsigned int col,
-    unsigned int reg,
-    unsigned int value
-    ) {
+static inline uint64_t solverRandom( SOLVER_CTX_S * pctx )
+{
+    uint64_t x = pctx->rng;
+    
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    
+    return pctx->rng = x;
+}
+
+static uint64_t solverSplitMix( uint64_t * pstate )
+{
     /*
-    ** Perform a 'pruning' operation on all remaining candidate squares.
-    ** Given the row, col, region and candidate value to prune, checks if the candidate square
-    ** has the same, row, column or region (which would cause an invalid board), and removes the candidate
-    ** value from its list of candidate values.
+    ** Returns the next number of a splitmix64 sequence. Every state, 0 included, gives a well
+    ** mixed result.
     */
-    unsigned int count = 0;
+    uint64_t z = (*pstate += 0x9E3779B97F4A7C15ull);
     
-    for( unsigned int cand=solver_candidate_current+1; cand<solver_candidate_count; cand++ )
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    
+    return z ^ (z >> 31);
+}
+
+static void solverRandomSeed( SOLVER_CTX_S * pctx, unsigned long long seed )
+{
+    /*
+    ** Seeds the generator through one splitmix64 step, so every seed gives a well mixed state,
+    ** which must never be zero.
+    */
+    uint64_t state = seed;
+    uint64_t z     = solverSplitMix( &state );
+    
+    pctx->rng = z ? z : 1;
+}
+
+static void solverLimitsSet( SOLVER_CTX_S * pctx, const SOLVER_OPTS_S * popts, int restarts )
+{
+    /*
+    ** Applies the limits in popts to the searches that follow, or goes back to no limits if popts
+    ** is NULL. The time limit starts now. If restarts is set, the restart schedule of the context
+    ** starts again too, and otherwise the searches that follow never restart.
+    */
+    pctx->pstop      = NULL;
+    pctx->pcancel    = popts ? popts->pcancel : NULL;
+    pctx->node_limit = popts ? popts->node_limit : 0;
+    pctx->deadline   = (popts && popts->time_limit_ns) ? solverNowNs() + popts->time_limit_ns : 0;
+    pctx->poll_nodes = 0;
+    
+    pctx->restart_count = 0;
+    pctx->restart_at    = restarts ? pctx->restart_base : 0;
+    
+    pctx->poll_next  = (pctx->pcancel || pctx->node_limit || pctx->deadline || pctx->restart_at) ? 0 : ~0ull;
+    
+    pctx->poll_interval = SOLVER_POLL_INTERVAL;
+}
+
+static int solverPoll( SOLVER_CTX_S * pctx )
+{
+    /*
+    ** Checks the limits on the search. Returns zero to carry on, or the result the search
+    ** stops with, and otherwise schedules the next check. Returns SOLVER_POLL_RESTART when the
+    ** restart schedule says so.
+    */
+    if( pctx->pstop != NULL && atomic_load_explicit( pctx->pstop, memory_order_relaxed ) )
+        return SOLVER_NO_SOLUTION;
+    
+    if( pctx->pcancel != NULL && atomic_load_explicit( pctx->pcancel, memory_order_relaxed ) )
+        return SOLVER_CANCELLED;
+    
+    if( pctx->node_limit != 0 && pctx->poll_nodes >= pctx->node_limit )
+        return SOLVER_TIMEOUT;
+    
+    if( pctx->deadline != 0 && solverNowNs() >= pctx->deadline )
+        return SOLVER_TIMEOUT;
+    
+    pctx->poll_next = pctx->poll_nodes + pctx->poll_interval;
+    
+    if( pctx->node_limit != 0 && pctx->poll_next > pctx->node_limit )
+        pctx->poll_next = pctx->node_limit;
+    
+    if( pctx->restart_at != 0 )
     {
-        if( solver_candidate_array[cand].row == row ||
-            solver_candidate_array[cand].col == col ||
-            solver_candidate_array[cand].reg == reg )
+        if( pctx->poll_nodes >= pctx->restart_at )
         {
-            if( solver_candidate_array[cand].val & value )
-            {
-                solver_candidate_array[cand].val &= ~value;
-                solver_candidate_array[cand].num--; /* Remove the value from the list of candidate values */
+            pctx->restart_count++;
+            pctx->restart_at = pctx->poll_nodes + (pctx->restart_base * solverLuby( pctx->restart_count ));
+            
+            if( pctx->poll_next > pctx->restart_at )
+                pctx->poll_next = pctx->restart_at;
+            
+            return SOLVER_POLL_RESTART;
+        }
+        
+        if( pctx->poll_next > pctx->restart_at )
+            pctx->poll_next = pctx->restart_at;
+    }
+    return 0;
+}
+
+static int solverPollValue( SOLVER_CTX_S * pctx )
+{
+    /*
+    ** Counts a value tried by the DLX or bitboard backend, checking the limits when they are due.
+    ** Returns zero to carry on, or the result the search stops with. Restarts are left to the
+    ** prune backend, so the other backends carry on through them.
+    */
+    int stop = 0;
+    
+    if( pctx->poll_nodes >= pctx->poll_next )
+        stop = solverPoll( pctx );
+    
+    pctx->poll_nodes++;
+    
+    return (stop == SOLVER_POLL_RESTART) ? 0 : stop;
+}
+
+static int solverPollBB( void * parg )
+{
+    return solverPollValue( (SOLVER_CTX_S *)parg );
+}
+
+static int solverSetGameboard( SOLVER_CTX_S * pctx, const SUDOKU_S * psudoku )
+{
+    /*
+    ** Stores the initial gameboard, and the values used in each unit.
+    ** Returns zero if the initial board breaks the rules, either with a value out of range or with
+    ** the same value twice in a unit. Such a board has no solution.
+    */
+    pctx->n  = psudoku->n;
+    pctx->nn = pctx->n * pctx->n;
+    
+    for( unsigned int unit=0; unit<3*pctx->nn; unit++ )
+    {
+        pctx->unit_used[unit] = 0;
+    }
+    
+    for( unsigned int row=0; row<pctx->nn; row++ )
+    {
+        for( unsigned int col=0; col<pctx->nn; col++ )
+        {
+            const unsigned char * punit = solver_units[pctx->n][(row * pctx->nn) + col];
+            
+            unsigned int val = 0;
+            unsigned int bv  = psudoku->board[row][col];
+            
+            if( bv > pctx->nn )
+                return 0;
+            
+            if( bv > 0 ) {
+                /*
+                ** Non-zero board entries are valid values.
+                ** Determine the bitfield representation for the value, which moves the 1
+                ** bit to the ordered position representing the value.
+                */
+                val = 1 << (bv - 1);
                 
-                solver_backtrack_stack[solver_backtrack_stack_top].bt.row = cand;
-                solver_backtrack_stack[solver_backtrack_stack_top].bt.val = value; /* Add the prune operation to the backtrack stack */
+                if( (pctx->unit_used[punit[0]] | pctx->unit_used[punit[1]] | pctx->unit_used[punit[2]]) & val )
+                    return 0;
                 
-                solver_backtrack_stack_top++;
-                count++;
+                pctx->unit_used[punit[0]] |= val;
+                pctx->unit_used[punit[1]] |= val;
+                pctx->unit_used[punit[2]] |= val;
             }
+    
+            pctx->gameboard.rows[row][col] = val;
         }
     }
+    return 1;
+}
+
+static void solverGenerateCandiates( SOLVER_CTX_S * pctx )
+{
     /*
-    ** Once all of the backtrack operations have been added, store the number of operations, as well as
-    ** the next possible value to check. This means that when a restore operation is performed, and the pruning
-    ** operations are undone, the backtracked candidate square knows where to resume is candidate value search.
+    ** Sets up the candidate square of every cell. The candidate values of an open cell are the
+    ** values used in none of its units, which the unit masks give in one step.
     */
-    solver_backtrack_stack[solver_backtrack_stack_top++].count = count;
-    solver_backtrack_stack[solver_backtrack_stack_top++].item  = value << 1;
+    unsigned int full = (1u << pctx->nn) - 1;
+    
+    pctx->candidate_count = pctx->nn * pctx->nn;
+    
+    for( unsigned int row=0; row<pctx->nn; row++ )
+    {
+        for( unsigned int col=0; col<pctx->nn; col++ )
+        {
+            unsigned int          cell  = (row * pctx->nn) + col;
+            const unsigned char * punit = solver_units[pctx->n][cell];
+            SOLVER_CANDITATE_S *  pc    = &pctx->candidate_array[cell];
+            
+            pc->row = row;
+            pc->col = col;
+            pc->reg = punit[2] - (2 * pctx->nn);
+            pc->num = 0;
+            pc->val = 0;
+            pc->set = pctx->gameboard.rows[row][col];
+            
+            if( pc->set != 0 )
+                continue;
+            
+            pc->val = full & ~(pctx->unit_used[punit[0]] | pctx->unit_used[punit[1]] | pctx->unit_used[punit[2]]);
+            pc->num = SOLVER_POPCOUNT32( pc->val );
+        }
+    }
+}
+
+static inline void solverBucketInsert( SOLVER_CTX_S * pctx, unsigned int cand )
+{
+    unsigned int num  = pctx->candidate_array[cand].num;
+    unsigned int head = SOLVER_BUCKET_HEAD( num );
+    
+    pctx->bucket_next[cand] = pctx->bucket_next[head];
+    pctx->bucket_prev[cand] = head;
+    pctx->bucket_prev[pctx->bucket_next[head]] = cand;
+    pctx->bucket_next[head] = cand;
+    
+    pctx->bucket_mask |= 1u << num;
+}
+
+static inline void solverBucketRemove( SOLVER_CTX_S * pctx, unsigned int cand )
+{
+    unsigned int num  = pctx->candidate_array[cand].num;
+    unsigned int head = SOLVER_BUCKET_HEAD( num );
+    
+    pctx->bucket_next[pctx->bucket_prev[cand]] = pctx->bucket_next[cand];
+    pctx->bucket_prev[pctx->bucket_next[cand]] = pctx->bucket_prev[cand];
+    
+    if( pctx->bucket_next[head] == head )
+        pctx->bucket_mask &= ~(1u << num);
 }
 
-unsigned short solverRestore( void ) {
+static unsigned int solverBucketPick( SOLVER_CTX_S * pctx )
+{
     /*
-    ** Undoes the last set of pruning operations.
-    ** Returns the next possible candidate value stored from the previous prune operation.
+    ** Returns the open cell to branch on with restarts on. Looks at up to SOLVER_RESTART_SCAN
+    ** cells of the lowest bucket and takes the one with the most conflicts, ties broken at random
+    ** so that each run of the search starts somewhere different.
     */
-    unsigned short item = solver_backtrack_stack[--solver_backtrack_stack_top].item;
-    unsigned int  count = solver_backtrack_stack[--solver_backtrack_stack_top].count;
+    unsigned int head  = SOLVER_BUCKET_HEAD( SOLVER_CTZ32( pctx->bucket_mask ) );
+    unsigned int best  = pctx->bucket_next[head];
+    unsigned int ties  = 1;
+    unsigned int count = 1;
     
-    for( unsigned int bt=0; bt<count; bt++ )
+    for( unsigned int cand=pctx->bucket_next[best]; cand!=head && count<SOLVER_RESTART_SCAN; cand=pctx->bucket_next[cand], count++ )
     {
-        SOLVER_BACKTRACK_S bt_s = solver_backtrack_stack[--solver_backtrack_stack_top];
-        
-        solver_candidate_array[bt_s.bt.row].val |= bt_s.bt.val;
-        solver_candidate_array[bt_s.bt.row].num++; /* Restores the candidate value */
+        if( pctx->conflicts[cand] > pctx->conflicts[best] )
+        {
+            best = cand;
+            ties = 1;
+        }
+        else if( pctx->conflicts[cand] == pctx->conflicts[best] && (solverRandom( pctx ) % ++ties) == 0 )
+        {
+            best = cand;
+        }
     }
-    return item;
+    return best;
 }
 
-unsigned char solverGetValue( unsigned short val_mask )
+static int solverTrailGrow( SOLVER_CTX_S * pctx )
 {
-    unsigned char  val  = 1;
-    unsigned short mask = 1;
+    /*
+    ** Adds a chunk to the backtracking stack. Returns zero, and marks the context as exhausted,
+    ** if the stack already holds SOLVER_TRAIL_MAX_BYTES or the memory cannot be allocated.
+    ** When the limit is not a whole number of chunks, the last chunk only holds the entries left
+    ** under it.
+    */
+    unsigned int chunk = pctx->backtrack_stack_size >> SOLVER_TRAIL_CHUNK_SHIFT;
+    unsigned int count = SOLVER_TRAIL_CHUNK_SIZE;
     
-    while( (val_mask & mask) == 0 )
+    if( pctx->backtrack_stack_size >= SOLVER_TRAIL_MAX_ENTRIES )
     {
-        mask <<= 1;
-        val++;
+        pctx->exhausted = 1;
+        return 0;
     }
-    if( mask > 0 )
-        return val;
-    else
+    
+    if( count > SOLVER_TRAIL_MAX_ENTRIES - pctx->backtrack_stack_size )
+        count = SOLVER_TRAIL_MAX_ENTRIES - pctx->backtrack_stack_size;
+    
+    pctx->backtrack_chunk[chunk] = (SOLVER_BACKTRACK_S *)malloc( count * sizeof(SOLVER_BACKTRACK_S) );
+    
+    if( pctx->backtrack_chunk[chunk] == NULL )
+    {
+        pctx->exhausted = 1;
         return 0;
+    }
+    
+    pctx->backtrack_stack_size += count;
+    return 1;
 }
 
+static inline int solverTrailPush( SOLVER_CTX_S * pctx, unsigned int row, unsigned int val )
+{
+    /*
+    ** Pushes one change onto the backtracking stack. Returns zero if the stack is full, in which
+    ** case the change must not be made.
+    */
+    unsigned int top = pctx->backtrack_stack_top;
+    
+    if( top == pctx->backtrack_stack_size && !solverTrailGrow( pctx ) )
+        return 0;
+    
+    SOLVER_BACKTRACK_S * pbt = &pctx->backtrack_chunk[top >> SOLVER_TRAIL_CHUNK_SHIFT][top & SOLVER_TRAIL_CHUNK_MASK];
+    
+    pbt->row = row;
+    pbt->val = val;
+    
+    pctx->backtrack_stack_top = ++top;
+    if( top > pctx->backtrack_stack_peak )
+        pctx->backtrack_stack_peak = top;
+    
+    SOLVER_STAT_MAX( pctx, trail_peak, top );
+    
+    return 1;
+}
 
-/*
-** EXPORTED FUNCTIONS
-*/
+static inline SOLVER_BACKTRACK_S solverTrailPop( SOLVER_CTX_S * pctx )
+{
+    unsigned int top = --pctx->backtrack_stack_top;
+    
+    return pctx->backtrack_chunk[top >> SOLVER_TRAIL_CHUNK_SHIFT][top & SOLVER_TRAIL_CHUNK_MASK];
+}
 
-int solverSolve( const SUDOKU_S * psudoku, SUDOKU_S * solution ) {
+static inline SOLVER_BACKTRACK_S solverTrailAt( const SOLVER_CTX_S * pctx, unsigned int index )
+{
+    return pctx->backtrack_chunk[index >> SOLVER_TRAIL_CHUNK_SHIFT][index & SOLVER_TRAIL_CHUNK_MASK];
+}
+
+static inline void solverEnqueue( SOLVER_CTX_S * pctx, unsigned int cand )
+{
+    if( !pctx->queued[cand] )
+    {
+        pctx->queued[cand] = 1;
+        pctx->queue[pctx->queue_tail++] = cand;
+    }
+}
+
+static inline void solverQueueClear( SOLVER_CTX_S * pctx )
+{
+    while( pctx->queue_head < pctx->queue_tail )
+    {
+        pctx->queued[pctx->queue[pctx->queue_head++]] = 0;
+    }
+    pctx->queue_head = 0;
+    pctx->queue_tail = 0;
+    pctx->unit_dirty = 0;
+}
+
+static int solverTableFind( SOLVER_TABLE_S * ptable, uint64_t hash )
+{
     /*
-    ** Attempts to find a solution to the initial board configuration given in psudoku.
-    ** The solution is provided in a second sudoku instance. This allows the caller to
-    ** differentiate the values generated by the algorithm from the initial values.
-    **
-    ** Returns non-zero if a solution was found, zero otherwise.
-    **
-    ** The algorithm currently only generates the first possible solution found.
-    ** It would be possible to adjust it to generate all solutions by forcing a backtrack operation
-    ** on the last candidate square and continuing the algorithm.
+    ** Returns non-zero if a state with the hash is known to have no solution.
     */
-    solverSetGameboard( psudoku );
-    solverGenerateCandiates( psudoku );
-    solverSortCandidates();
-        /*
-        ** Sort the candidates by number of possible candidate values.
-        ** Initially done as a possible optimization by processing candidates with a small number of
-        ** candidate values (possibly one). However, this would only work if you resorted the candidates after
-        ** each candidate value is chosen. This could potentially mean (for simpler puzzles) that most candidates
-        ** would have only one possible value, which would simplify the search. However, the cost of sorting the
-        ** entries regularily would be detrimental to the running time.
-        ** The initial sort is left in anyway.
-        */
-    
-    solver_backtrack_stack_top = 0;
-    solver_solution_stack_top  = 0;
-    solver_candidate_current   = 0;
+    _Atomic uint64_t * pslot = &ptable->slot[(hash & ptable->mask) * SOLVER_TABLE_WAYS];
     
-    unsigned short cand_mask = 1;
+    for( unsigned int w=0; w<SOLVER_TABLE_WAYS; w++ )
+    {
+        if( atomic_load_explicit( &pslot[w], memory_order_relaxed ) == (hash | 1) )
+            return 1;
+    }
+    return 0;
+}
+
+static void solverTableStore( SOLVER_TABLE_S * ptable, uint64_t hash )
+{
+    /*
+    ** Records that the state with the hash has no solution. Takes an empty slot in its bucket if
+    ** there is one, and otherwise replaces an entry picked by the hash.
+    */
+    _Atomic uint64_t * pslot = &ptable->slot[(hash & ptable->mask) * SOLVER_TABLE_WAYS];
     
-    while( solver_candidate_current < solver_candidate_count )
+    for( unsigned int w=0; w<SOLVER_TABLE_WAYS; w++ )
     {
-        SOLVER_CANDITATE_S cand = solver_candidate_array[solver_candidate_current];
-        /*
-        ** Go through each candidate in order, as search for possible candidate values for each.
-        ** The cand_mask is the bitfield representing the current value being tested.
-        */
-        int searching = 1;
+        uint64_t key = atomic_load_explicit( &pslot[w], memory_order_relaxed );
+        
+        if( key == (hash | 1) )
+            return;
         
-        while( searching )
+        if( key == 0 )
         {
-            while( cand_mask > 0 && (cand_mask & cand.val) == 0 ) cand_mask <<= 1; /* Skip until candidate value is found */
-            
-            if( cand_mask > 0 )
-            {
-                /*
-                ** Possible candidate found.
-                ** Check to see if it is a valid candidate, and if so, prune it from the remaining candidates and
-                ** move on to the next candidate square.
-                */
-                if( solverRowHasValue(cand.row, cand_mask) == 0 &&
-                    solverColHasValue(cand.col, cand_mask) == 0 &&
-                    solverRegHasValue(cand.reg, cand_mask) == 0 )
-                {
-                    solverPrune(cand.row, cand.col, cand.reg, cand_mask);
-                    
-                    solver_solution_stack[solver_solution_stack_top].row = cand.row;
-                    solver_solution_stack[solver_solution_stack_top].col = cand.col;
-                    solver_solution_stack[solver_solution_stack_top].val = cand_mask;
-                    solver_solution_stack_top++;
-                    
-                    solver_candidate_current++;
-                    cand_mask = 1;
-                    searching = 0;
-                }
-                else
-                {
-                    cand_mask <<= 1; /* Move to next possible candidate value */
-                }
-            }
-            else
-            {
-                /*
-                ** All candidate values have been searched.
-                ** This will happen when the cand_mask 1 bit is shifted past the length of the value.
-                */
-                if( solver_candidate_current > 0 )
-                {
-                    /*
-                    ** Were not on the first candidate, so perform a backtrack, restoring any pruned values.
-                    */
-                    cand_mask = solverRestore();
-                    solver_solution_stack_top--;
-                    solver_candidate_current--;
-                }
-                else
-                {
-                    SW_INFO("No solution exists");
-                    return 0;
-                }
-                searching = 0;
-            }
+            atomic_store_explicit( &pslot[w], hash | 1, memory_order_relaxed );
+            return;
         }
     }
+    atomic_store_explicit( &pslot[(hash >> 32) % SOLVER_TABLE_WAYS], hash | 1, memory_order_relaxed );
+}
+
+static inline void solverTableNote( SOLVER_CTX_S * pctx, uint64_t hash )
+{
+    /*
+    ** Stores a state the search has found to have no solution, if there is a table and the state
+    ** was searched before any solution was returned.
+    */
+    if( pctx->ptable != NULL && !pctx->found )
+    {
+        solverTableStore( pctx->ptable, hash );
+        SOLVER_STAT_ADD( pctx, table_stores, 1 );
+    }
+}
+
+static inline void solverConflict( SOLVER_CTX_S * pctx, unsigned int kind, unsigned int at, unsigned int vi )
+{
+    pctx->conflict_kind = kind;
+    pctx->conflict_at   = at;
+    pctx->conflict_vi   = vi;
+}
+
+static void solverLearnStart( SOLVER_CTX_S * pctx )
+{
     /*
-    ** If we reach this point, all candidate squares have been assigned values, so a solution exists.
-    ** Fill in the solution with the values stored on the solution stack.
+    ** Gets the context ready to learn during the coming search, if learning was asked for.
+    ** Nogoods only hold for the board they were learned from, so the store starts empty.
+    ** Learning is quietly left off if the store cannot be allocated.
     */
-    for( int x=0; x<solver_solution_stack_top; x++ )
+    unsigned int capacity = pctx->learn_max < SOLVER_NOGOOD_MAX ? pctx->learn_max : SOLVER_NOGOOD_MAX;
+    
+    pctx->learning = 0;
+    
+    if( capacity == 0 )
+        return;
+    
+    if( pctx->plearn == NULL || pctx->plearn->capacity != capacity )
     {
-        solution->board[solver_solution_stack[x].row][solver_solution_stack[x].col] = solverGetValue( solver_solution_stack[x].val );
+        free( pctx->plearn );
+        
+        pctx->plearn = (SOLVER_LEARN_S *)malloc( sizeof(SOLVER_LEARN_S) + (capacity * sizeof(SOLVER_NOGOOD_S)) );
+        if( pctx->plearn == NULL )
+            return;
+        
+        pctx->plearn->capacity = capacity;
     }
     
-    SW_INFO("Algorithm complete");
+    SOLVER_LEARN_S * pl = pctx->plearn;
     
-    return 1;
+    pl->used     = 0;
+    pl->lru_head = SOLVER_NOGOOD_NONE;
+    pl->lru_tail = SOLVER_NOGOOD_NONE;
+    
+    memset( pl->watch_head, 0xFF, sizeof(pl->watch_head) );
+    memset( pl->seen, 0, sizeof(pl->seen) );
+    memset( pctx->prune_cause, 0xFF, sizeof(pctx->prune_cause) );
+    memset( pctx->assign_level, 0, sizeof(pctx->assign_level) );
+    
+    pctx->learning = 1;
+}
+
+static void solverNogoodUnlinkLru( SOLVER_LEARN_S * pl, unsigned int g )
+{
+    SOLVER_NOGOOD_S * png = &pl->nogood[g];
+    
+    if( png->lru_prev != SOLVER_NOGOOD_NONE )
+        pl->nogood[png->lru_prev].lru_next = png->lru_next;
+    else
+        pl->lru_head = png->lru_next;
+    
+    if( png->lru_next != SOLVER_NOGOOD_NONE )
+        pl->nogood[png->lru_next].lru_prev = png->lru_prev;
+    else
+        pl->lru_tail = png->lru_prev;
+}
+
+static void solverNogoodPushLru( SOLVER_LEARN_S * pl, unsigned int g )
+{
+    SOLVER_NOGOOD_S * png = &pl->nogood[g];
+    
+    png->lru_prev = SOLVER_NOGOOD_NONE;
+    png->lru_next = pl->lru_head;
+    
+    if( pl->lru_head != SOLVER_NOGOOD_NONE )
+        pl->nogood[pl->lru_head].lru_prev = g;
+    else
+        pl->lru_tail = g;
+    
+    pl->lru_head = g;
 }
 
+static inline void solverNogoodTouch( SOLVER_LEARN_S * pl, unsigned int g )
+{
+    if( pl->lru_head != g )
+    {
+        solverNogoodUnlinkLru( pl, g );
+        solverNogoodPushLru( pl, g );
+    }
+}
+
+static int solverNogoodLocked( const SOLVER_CTX_S * pctx, unsigned int g )
+{
+    /*
+    ** Returns non-zero if a value pruned by the nogood may still be on the backtracking stack,
+    ** in which case learning could still follow the prune back to the nogood. A nogood only ever
+    ** prunes one of its own literals, so those are the only places to look.
+    */
+    const SOLVER_NOGOOD_S * png = &pctx->plearn->nogood[g];
+    
+    for( unsigned int k=0; k<png->count; k++ )
+    {
+        unsigned int               cell  = png->lit[k] >> 4;
+        unsigned int               vi    = png->lit[k] & 15;
+        const SOLVER_CANDITATE_S * pc    = &pctx->candidate_array[cell];
+        unsigned int               value = 1u << vi;
+        
+        if( pctx->prune_cause[cell][vi] == (SOLVER_CAUSE_NOGOOD | g) &&
+            (pc->set != 0 ? pc->set != value : (pc->val & value) == 0) )
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
 
+static void solverNogoodUnwatch( SOLVER_LEARN_S * pl, unsigned int g, unsigned int w )
+{
+    unsigned int * plink = &pl->watch_head[pl->nogood[g].lit[w]];
+    
+    while( *plink != g )
+    {
+        SOLVER_NOGOOD_S * pnext = &pl->nogood[*plink];
+        
+        plink = &pnext->watch_next[pnext->lit[0] == pl->nogood[g].lit[w] ? 0 : 1];
+    }
+    *plink = pl->nogood[g].watch_next[w];
+}
 
+static unsigned int solverNogoodAdd( SOLVER_CTX_S * pctx, const unsigned short * plits, unsigned int count )
+{
+    /*
+    ** Stores a nogood, replacing the least recently used one if the store is full. plits[0]
+    ** and plits[1] become the watched literals. Returns the index of the nogood, or
+    ** SOLVER_NOGOOD_NONE if every nogood that could be replaced is still needed.
+    */
+    SOLVER_LEARN_S * pl = pctx->plearn;
+    unsigned int     g  = SOLVER_NOGOOD_NONE;
+    
+    if( pl->used < pl->capacity )
+    {
+        g = pl->used++;
+    }
+    else
+    {
+        unsigned int tries = 0;
+        
+        for( g=pl->lru_tail; g!=SOLVER_NOGOOD_NONE && tries<8; g=pl->nogood[g].lru_prev, tries++ )
+        {
+            if( !solverNogoodLocked( pctx, g ) )
+                break;
+        }
+        if( g == SOLVER_NOGOOD_NONE || tries == 8 )
+            return SOLVER_NOGOOD_NONE;
+        
+        solverNogoodUnwatch( pl, g, 0 );
+        solverNogoodUnwatch( pl, g, 1 );
+        solverNogoodUnlinkLru( pl, g );
+    }
+    
+    SOLVER_NOGOOD_S * png = &pl->nogood[g];
+    
+    memcpy( png->lit, plits, count * sizeof(png->lit[0]) );
+    png->count = count;
+    
+    for( unsigned int w=0; w<2; w++ )
+    {
+        png->watch_next[w] = pl->watch_head[png->lit[w]];
+        pl->watch_head[png->lit[w]] = g;
+    }
+    solverNogoodPushLru( pl, g );
+    
+    SOLVER_STAT_ADD( pctx, learned, 1 );
+    return g;
+}
+
+
+/*
+** ENGINES
+**
+** The propagation and search are written once in solver_tpl.h and compiled for each box size,
+** so each board size gets code with its own constant loop bounds. The engine for a board is
+** selected from pctx->n.
+*/
+
+#define SOLVER_PASTE(a, b) a##b
+#define SOLVER_NAME(a, b)  SOLVER_PASTE(a, b)
+
+#define SOLVER_TPL_N      1
+#define SOLVER_TPL_SUFFIX _n1
+#include "solver_tpl.h"
+#undef SOLVER_TPL_N
+#undef SOLVER_TPL_SUFFIX
+
+#define SOLVER_TPL_N      2
+#define SOLVER_TPL_SUFFIX _n2
+#include "solver_tpl.h"
+#undef SOLVER_TPL_N
+#undef SOLVER_TPL_SUFFIX
+
+#define SOLVER_TPL_N      3
+#define SOLVER_TPL_SUFFIX _n3
+#include "solver_tpl.h"
+#undef SOLVER_TPL_N
+#undef SOLVER_TPL_SUFFIX
+
+#define SOLVER_TPL_N      4
+#define SOLVER_TPL_SUFFIX _n4
+#include "solver_tpl.h"
+#undef SOLVER_TPL_N
+#undef SOLVER_TPL_SUFFIX
+
+static void solverInitEngines( void )
+{
+    uint64_t state = 0;
+    
+    for( unsigned int cell=0; cell<SOLVER_CANDIDATE_ARRAY_SIZE; cell++ )
+    {
+        for( unsigned int vi=0; vi<16; vi++ )
+            solver_zobrist[cell][vi] = solverSplitMix( &state );
+    }
+    for( unsigned int n=0; n<5; n++ )
+        solver_zobrist_size[n] = solverSplitMix( &state );
+    
+    solverTplInit_n1();
+    solverTplInit_n2();
+    solverTplInit_n3();
+    solverTplInit_n4();
+}
+
+static int solverPropagate( SOLVER_CTX_S * pctx )
+{
+    switch( pctx->n )
+    {
+        case 1:  return solverPropagate_n1( pctx );
+        case 2:  return solverPropagate_n2( pctx );
+        case 3:  return solverPropagate_n3( pctx );
+        default: return solverPropagate_n4( pctx );
+    }
+}
+
+static int solverSearch( SOLVER_CTX_S * pctx, int resume )
+{
+    unsigned long long start = SOLVER_STAT_NOW();
+    int                result;
+    
+    switch( pctx->n )
+    {
+        case 1:  result = solverSearch_n1( pctx, resume ); break;
+        case 2:  result = solverSearch_n2( pctx, resume ); break;
+        case 3:  result = solverSearch_n3( pctx, resume ); break;
+        default: result = solverSearch_n4( pctx, resume ); break;
+    }
+    
+    SOLVER_STAT_TIME( pctx, search_ns, start );
+    return result;
+}
+
+static void solverStatsClear( SOLVER_CTX_S * pctx )
+{
+    memset( &pctx->stats, 0, sizeof(pctx->stats) );
+}
+
+static void solverStatsMerge( SOLVER_STATS_S * pto, const SOLVER_STATS_S * pfrom )
+{
+    /*
+    ** Adds the statistics of one worker to the total. Peaks are the highest of any worker.
+    */
+    pto->nodes       += pfrom->nodes;
+    pto->assignments += pfrom->assignments;
+    pto->backtracks  += pfrom->backtracks;
+    pto->prunes      += pfrom->prunes;
+    pto->probes      += pfrom->probes;
+    pto->learned     += pfrom->learned;
+    pto->backjumps   += pfrom->backjumps;
+    pto->restarts    += pfrom->restarts;
+    
+    pto->table_hits   += pfrom->table_hits;
+    pto->table_misses += pfrom->table_misses;
+    pto->table_stores += pfrom->table_stores;
+    
+    if( pfrom->trail_peak > pto->trail_peak )
+        pto->trail_peak = pfrom->trail_peak;
+    if( pfrom->depth_peak > pto->depth_peak )
+        pto->depth_peak = pfrom->depth_peak;
+    
+    for( int d=0; d<SOLVER_STATS_DEPTHS; d++ )
+    {
+        pto->decisions[d] += pfrom->decisions[d];
+        pto->branches [d] += pfrom->branches [d];
+    }
+    
+    pto->setup_ns   += pfrom->setup_ns;
+    pto->candgen_ns += pfrom->candgen_ns;
+    pto->sort_ns    += pfrom->sort_ns;
+    pto->search_ns  += pfrom->search_ns;
+}
+
+static unsigned char solverGetValue( unsigned short val_mask )
+{
+    /*
+    ** Returns the value of the lowest bit set in the mask, or 0 if there is none.
+    */
+    return val_mask ? (unsigned char)(SOLVER_CTZ32( val_mask ) + 1) : 0;
+}
+
+static int solverPruneStart( SOLVER_CTX_S * pctx, const SUDOKU_S * psudoku )
+{
+    /*
+    ** Sets up the context for a search of the initial board configuration given in psudoku,
+    ** and propagates from it. Returns zero if the board has no solution.
+    */
+    pctx->search_state        = SOLVER_SEARCH_NONE;
+    pctx->backtrack_stack_top = 0;
+    pctx->decision_stack_top  = 0;
+    pctx->exhausted           = 0; /* Cleared before any early return below */
+    
+    pthread_once( &solver_once, solverInitEngines );
+    
+    unsigned long long start = SOLVER_STAT_NOW();
+    
+    if( psudoku->n < 1 || psudoku->n > 4 || !solverSetGameboard( pctx, psudoku ) )
+        return 0;
+    
+    SOLVER_STAT_TIME( pctx, setup_ns, start );
+    start = SOLVER_STAT_NOW();
+    
+    solverGenerateCandiates( pctx );
+    
+    SOLVER_STAT_TIME( pctx, candgen_ns, start );
+    start = SOLVER_STAT_NOW();
+        /*
+        ** The candidates used to be sorted once here by number of possible candidate values, since
+        ** re-sorting after each value is chosen would cost too much. The buckets keep that order up to
+        ** date instead, at constant cost per change, so no sort is needed.
+        */
+    
+    pctx->queue_head = 0;
+    pctx->queue_tail = 0;
+    pctx->unit_dirty = ((uint64_t)1 << (3 * pctx->nn)) - 1;
+    
+    pctx->bucket_mask = 0;
+    
+    for( unsigned int num=0; num<SOLVER_BUCKET_COUNT; num++ )
+    {
+        pctx->bucket_next[SOLVER_BUCKET_HEAD( num )] = SOLVER_BUCKET_HEAD( num );
+        pctx->bucket_prev[SOLVER_BUCKET_HEAD( num )] = SOLVER_BUCKET_HEAD( num );
+    }
+    
+    memset( pctx->unit_where, 0, sizeof(pctx->unit_where) );
+    
+    for( unsigned int cell=0; cell<pctx->candidate_count; cell++ )
+    {
+        const SOLVER_CANDITATE_S * pc = &pctx->candidate_array[cell];
+        
+        pctx->queued[cell] = 0;
+        
+        if( pc->set != 0 )
+            continue;
+        
+        if( pc->num <= 1 )
+            solverEnqueue( pctx, cell );
+        
+        solverBucketInsert( pctx, cell );
+        
+        const unsigned char *  punit = solver_units[pctx->n][cell];
+        const unsigned short * pslot = solver_unit_slot[pctx->n][cell];
+        
+        for( unsigned int m=pc->val; m!=0; m&=m-1 )
+        {
+            unsigned int vi = SOLVER_CTZ32( m );
+            
+            pctx->unit_where[punit[0]][vi] |= pslot[0];
+            pctx->unit_where[punit[1]][vi] |= pslot[1];
+            pctx->unit_where[punit[2]][vi] |= pslot[2];
+        }
+    }
+    
+    SOLVER_STAT_TIME( pctx, sort_ns, start );
+    start = SOLVER_STAT_NOW();
+    
+    solverLearnStart( pctx );
+    
+    if( pctx->restart_base != 0 )
+        memset( pctx->conflicts, 0, sizeof(pctx->conflicts) );
+    
+    pctx->hash  = solver_zobrist_size[pctx->n];
+    pctx->found = 0;
+    
+    for( unsigned int cell=0; cell<pctx->candidate_count; cell++ )
+    {
+        if( pctx->candidate_array[cell].set != 0 )
+            pctx->hash ^= solver_zobrist[cell][SOLVER_CTZ32( pctx->candidate_array[cell].set )];
+    }
+    
+    /*
+    ** Propagate from the initial board. Anything placed here is never undone, since it holds
+    ** for every solution.
+    */
+    int result = solverPropagate( pctx );
+    
+    SOLVER_STAT_TIME( pctx, search_ns, start );
+    return result;
+}
+
+static void solverPruneFill( const SOLVER_CTX_S * pctx, SUDOKU_S * solution )
+{
+    /*
+    ** Fills in the solution with the values placed in the candidate array.
+    ** Only called once every candidate square has been assigned a value.
+    */
+    for( unsigned int cell=0; cell<pctx->candidate_count; cell++ )
+    {
+        const SOLVER_CANDITATE_S * pc = &pctx->candidate_array[cell];
+        
+        if( pctx->gameboard.rows[pc->row][pc->col] == 0 )
+            solution->board[pc->row][pc->col] = solverGetValue( pc->set );
+    }
+}
+
+static void solverPruneFillAll( const SOLVER_CTX_S * pctx, SUDOKU_S * solution )
+{
+    /*
+    ** Same as solverPruneFill, but also fills in the initial values from the gameboard, so the
+    ** solution is complete without needing the initial board.
+    */
+    solution->n = pctx->n;
+    
+    for( unsigned int row=0; row<pctx->nn; row++ )
+    {
+        for( unsigned int col=0; col<pctx->nn; col++ )
+        {
+            solution->board[row][col] = pctx->gameboard.rows[row][col] ? solverGetValue( pctx->gameboard.rows[row][col] ) : 0;
+        }
+    }
+    solverPruneFill( pctx, solution );
+}
+
+static int solverPruneSolve( SOLVER_CTX_S * pctx, const SUDOKU_S * psudoku, SUDOKU_S * solution ) {
+    /*
+    ** Attempts to find a solution to the initial board configuration given in psudoku.
+    ** The solution is provided in a second sudoku instance. This allows the caller to
+    ** differentiate the values generated by the algorithm from the initial values.
+    **
+    ** Returns SOLVER_SOLVED if a solution was found, SOLVER_NO_SOLUTION if there is none, or
+    ** SOLVER_EXHAUSTED if the backtracking stack ran out of room.
+    ** Only the first solution found is generated. solverPruneCount carries on to find the rest.
+    */
+    if( !solverPruneStart( pctx, psudoku ) )
+        return pctx->exhausted ? SOLVER_EXHAUSTED : SOLVER_NO_SOLUTION;
+    
+    int result = solverSearch( pctx, 0 );
+    
+    if( result == SOLVER_SOLVED )
+        solverPruneFill( pctx, solution );
+    
+    return result;
+}
+
+static unsigned long long solverPruneCount(
+    SOLVER_CTX_S *     pctx,
+    const SUDOKU_S *   psudoku,
+    unsigned long long limit,
+    SUDOKU_S *         solutions
+    ) {
+    /*
+    ** Counts the solutions of the board, stopping once limit have been found.
+    ** Each time a solution is found, the search is resumed by forcing a backtrack on the last
+    ** decision, so the whole tree is covered with the same search used to find one solution.
+    **
+    ** If the backtracking stack runs out of room, counting stops there and pctx->exhausted is set.
+    */
+    unsigned long long count = 0;
+    
+    if( !solverPruneStart( pctx, psudoku ) )
+        return 0;
+    
+    while( solverSearch( pctx, count > 0 ) == SOLVER_SOLVED )
+    {
+        if( solutions != NULL && count < 2 )
+        {
+            solutions[count] = *psudoku;
+            solverPruneFill( pctx, &solutions[count] );
+        }
+        
+        if( ++count == limit )
+            break;
+    }
+    return count;
+}
+
+static void solverSnapshot( const SOLVER_CTX_S * pctx, SUDOKU_S * psnap )
+{
+    /*
+    ** Stores the current state of the search as a board, with every value placed so far
+    ** filled in and the open cells left blank.
+    */
+    psnap->n = pctx->n;
+    
+    for( unsigned int cell=0; cell<pctx->candidate_count; cell++ )
+    {
+        const SOLVER_CANDITATE_S * pc = &pctx->candidate_array[cell];
+        
+        psnap->board[pc->row][pc->col] = pc->set ? solverGetValue( pc->set ) : 0;
+    }
+}
+
+static void solverParallelTask( POOL_S * ppool, int worker, POOL_TASK_S task )
+{
+    /*
+    ** Searches the subproblem in snapshot task.lo, which is task.hi decisions deep.
+    **
+    ** Shallow subproblems are not searched. Instead they branch on their most constrained cell
+    ** and submit one new subproblem per value, which idle workers steal. Deeper ones are searched
+    ** in full, giving up as soon as another worker has found a solution.
+    */
+    SOLVER_PARALLEL_S * ppar = (SOLVER_PARALLEL_S *)task.parg;
+    SOLVER_CTX_S *      pctx = ppar->ppctx[worker];
+    
+    if( atomic_load_explicit( &ppar->cancel, memory_order_relaxed ) )
+        return;
+    
+    if( !solverPruneStart( pctx, &ppar->snapshot[task.lo] ) )
+    {
+        if( pctx->exhausted )
+            atomic_store( &ppar->exhausted, 1 );
+        return;
+    }
+    
+    if( task.hi < SOLVER_PARALLEL_SPLIT_DEPTH && pctx->bucket_mask != 0 )
+    {
+        unsigned int cell  = pctx->bucket_next[SOLVER_BUCKET_HEAD( SOLVER_CTZ32( pctx->bucket_mask ) )];
+        unsigned int vals  = pctx->candidate_array[cell].val;
+        unsigned int count = pctx->candidate_array[cell].num;
+        unsigned int first = atomic_fetch_add( &ppar->snapshot_count, count );
+        
+        if( first + count <= SOLVER_PARALLEL_MAX_TASKS )
+        {
+            for( unsigned int i=0; i<count; i++ )
+            {
+                SUDOKU_S *   psnap = &ppar->snapshot[first + i];
+                unsigned int value = vals & -vals;
+                
+                vals &= vals - 1;
+                
+                solverSnapshot( pctx, psnap );
+                psnap->board[pctx->candidate_array[cell].row][pctx->candidate_array[cell].col] = solverGetValue( value );
+                
+                POOL_TASK_S child = { solverParallelTask, ppar, first + i, task.hi + 1 };
+                
+                poolSubmit( ppool, worker, child );
+            }
+            return;
+        }
+    }
+    
+    int result = solverSearch( pctx, 0 );
+    
+    if( result == SOLVER_EXHAUSTED )
+        atomic_store( &ppar->exhausted, 1 );
+    
+    if( result == SOLVER_TIMEOUT || result == SOLVER_CANCELLED )
+    {
+        /*
+        ** The whole search is over once any worker reaches a limit, since the rest of the tree
+        ** can no longer be searched in full.
+        */
+        atomic_store( &ppar->stopped, result );
+        atomic_store( &ppar->cancel, 1 );
+    }
+    
+    if( result == SOLVER_SOLVED && atomic_exchange( &ppar->found, 1 ) == 0 )
+    {
+        solverPruneFillAll( pctx, &ppar->result );
+        atomic_store( &ppar->cancel, 1 );
+    }
+}
+
+static int solverParallelSolve( SOLVER_CTX_S * pctx, const SUDOKU_S * psudoku, SUDOKU_S * solution, int threads )
+{
+    /*
+    ** Searches a single board with a pool of workers. The given context is used by worker 0,
+    ** and a context is created for each of the others.
+    */
+    if( threads <= 0 )
+        threads = poolCpuCount();
+    
+    if( threads == 1 )
+        return solverPruneSolve( pctx, psudoku, solution );
+    
+    SOLVER_TRACE_S * ptrace = pctx->ptrace;
+    
+    pctx->ptrace = NULL; /* Events from several subproblems at once would make no sense */
+    
+    SOLVER_CTX_S *    ctx_a[ threads ];
+    SOLVER_PARALLEL_S par;
+    int               ok = 1;
+    
+    ctx_a[0] = pctx;
+    for( int w=1; w<threads; w++ )
+    {
+        ctx_a[w] = solverCtxCreate();
+        if( ctx_a[w] == NULL )
+        {
+            ok = 0;
+            continue;
+        }
+        
+        /*
+        ** Each worker has the caller's limits. The node limit applies to each worker on its own.
+        */
+        ctx_a[w]->pcancel    = pctx->pcancel;
+        ctx_a[w]->node_limit = pctx->node_limit;
+        ctx_a[w]->deadline   = pctx->deadline;
+        ctx_a[w]->level      = pctx->level;
+        ctx_a[w]->probe_max  = pctx->probe_max;
+        ctx_a[w]->learn_max  = pctx->learn_max;
+        
+        ctx_a[w]->restart_base = pctx->restart_base;
+        ctx_a[w]->restart_at   = pctx->restart_at;
+        solverRandomSeed( ctx_a[w], pctx->rng + w );
+        
+        ctx_a[w]->ptable = pctx->ptable; /* Shared, so each worker gains from what the others rule out */
+    }
+    
+    for( int w=0; w<threads; w++ )
+    {
+        if( ctx_a[w] != NULL )
+        {
+            ctx_a[w]->pstop     = &par.cancel;
+            ctx_a[w]->poll_next = 0;
+        }
+    }
+    
+    par.snapshot = (SUDOKU_S *)malloc( SOLVER_PARALLEL_MAX_TASKS * sizeof(SUDOKU_S) );
+    par.ppctx    = ctx_a;
+    atomic_init( &par.snapshot_count, 1 );
+    atomic_init( &par.cancel, 0 );
+    atomic_init( &par.found,  0 );
+    atomic_init( &par.exhausted, 0 );
+    atomic_init( &par.stopped, 0 );
+    
+    POOL_S * ppool = NULL;
+    
+    if( ok && par.snapshot != NULL )
+        ppool = poolCreate( threads );
+    
+    int result = SOLVER_NO_SOLUTION;
+    
+    if( ppool != NULL )
+    {
+        POOL_TASK_S task = { solverParallelTask, &par, 0, 0 };
+        
+        par.snapshot[0] = *psudoku;
+        
+        poolSubmit( ppool, -1, task );
+        poolWait( ppool );
+        poolDestroy( ppool );
+        
+        if( atomic_load( &par.found ) )
+        {
+            for( unsigned int row=0; row<psudoku->n*psudoku->n; row++ )
+            {
+                for( unsigned int col=0; col<psudoku->n*psudoku->n; col++ )
+                {
+                    if( psudoku->board[row][col] == 0 )
+                        solution->board[row][col] = par.result.board[row][col];
+                }
+            }
+            result = SOLVER_SOLVED;
+        }
+        else if( atomic_load( &par.exhausted ) )
+        {
+            result = SOLVER_EXHAUSTED; /* Part of the tree was not searched */
+        }
+        else if( atomic_load( &par.stopped ) )
+        {
+            result = atomic_load( &par.stopped );
+        }
+    }
+    else
+    {
+        pctx->pstop = NULL;
+        result = solverPruneSolve( pctx, psudoku, solution ); /* Could not start the workers */
+    }
+    
+    pctx->pstop = NULL;
+    
+    free( par.snapshot );
+    for( int w=1; w<threads; w++ )
+    {
+        if( ctx_a[w] != NULL )
+            solverStatsMerge( &pctx->stats, &ctx_a[w]->stats );
+        
+        solverCtxDestroy( ctx_a[w] );
+    }
+    
+    pctx->ptrace = ptrace;
+    return result;
+}
+
+static size_t solverCountSplit(
+    SOLVER_CTX_S *       pctx,
+    const SUDOKU_S *     psudoku,
+    SUDOKU_S *           psubtree,
+    unsigned long long * pcount,
+    int *                pexhausted
+    ) {
+    /*
+    ** Splits the search tree of psudoku into subtrees for a parallel count, breadth first.
+    ** psubtree needs room for SOLVER_COUNT_MAX_SUBTREES boards and receives one snapshot per subtree.
+    ** Solutions found before the tree is split far enough, which happens for small trees, are
+    ** added to pcount. Returns the number of subtrees, and sets pexhausted if any of them
+    ** could not be set up.
+    */
+    SUDOKU_S *   plevel = (SUDOKU_S *)malloc( SOLVER_COUNT_MAX_SUBTREES * sizeof(SUDOKU_S) );
+    size_t       count  = 1;
+    unsigned int nn     = psudoku->n * psudoku->n;
+    
+    psubtree[0] = *psudoku;
+    
+    while( plevel != NULL && count > 0 && count < SOLVER_COUNT_SUBTREES && count * nn <= SOLVER_COUNT_MAX_SUBTREES )
+    {
+        size_t next = 0;
+        
+        for( size_t i=0; i<count; i++ )
+        {
+            if( !solverPruneStart( pctx, &psubtree[i] ) )
+            {
+                if( pctx->exhausted )
+                    *pexhausted = 1;
+                continue;
+            }
+            
+            if( pctx->bucket_mask == 0 )
+            {
+                (*pcount)++; /* Solved by propagation alone */
+                continue;
+            }
+            
+            unsigned int cell = pctx->bucket_next[SOLVER_BUCKET_HEAD( SOLVER_CTZ32( pctx->bucket_mask ) )];
+            unsigned int vals = pctx->candidate_array[cell].val;
+            
+            while( vals != 0 )
+            {
+                unsigned int value = vals & -vals;
+                
+                vals &= vals - 1;
+                
+                solverSnapshot( pctx, &plevel[next] );
+                plevel[next].board[pctx->candidate_array[cell].row][pctx->candidate_array[cell].col] = solverGetValue( value );
+                next++;
+            }
+        }
+        
+        for( size_t i=0; i<next; i++ )
+        {
+            psubtree[i] = plevel[i];
+        }
+        count = next;
+    }
+    
+    free( plevel );
+    return count;
+}
+
+static void solverCountTask( POOL_S * ppool, int worker, POOL_TASK_S task )
+{
+    /*
+    ** Counts the solutions in a range of subtrees, splitting large ranges for other workers
+    ** to steal in the same way as a batch.
+    */
+    SOLVER_COUNT_S * pjob = (SOLVER_COUNT_S *)task.parg;
+    SOLVER_CTX_S *   pctx = pjob->ppctx[worker];
+    
+    while( task.hi - task.lo > 1 )
+    {
+        POOL_TASK_S half = task;
+        
+        half.lo = task.lo + ((task.hi - task.lo) / 2);
+        task.hi = half.lo;
+        
+        poolSubmit( ppool, worker, half );
+    }
+    
+    for( size_t t=task.lo; t<task.hi; t++ )
+    {
+        unsigned long long found = solverPruneCount( pctx, &pjob->psubtree[t], 0, NULL );
+        
+        pjob->pcount[worker] += found;
+        
+        pthread_mutex_lock( &pjob->mutex );
+        if( pctx->exhausted )
+            pjob->exhausted = 1;
+        pjob->done++;
+        pjob->found += found;
+        if( pjob->pfunc != NULL )
+            pjob->pfunc( pjob->done, pjob->total, pjob->found, pjob->parg );
+        pthread_mutex_unlock( &pjob->mutex );
+    }
+}
+
+/*
+** DANCING LINKS BACKEND
+**
+** Solves the board as an exact cover problem using Knuth's Algorithm X with dancing links.
+** Each column of the cover matrix is a constraint that must be satisfied exactly once.
+**
+**  - Each cell holds one value.
+**  - Each row holds each value once.
+**  - Each column holds each value once.
+**  - Each region holds each value once.
+**
+** Each row of the matrix is one possible placement of a value in a cell, and covers exactly one
+** constraint of each kind. Columns for constraints already satisfied by the initial board are left
+** out, as are rows for placements the initial board rules out.
+**
+** At each step the column with the fewest remaining rows is chosen. This gives the search the most
+** constrained choice at every level, without the static candidate order used by the prune backend.
+*/
+
+static void solverDlxCover( SOLVER_DLX_S * pdlx, unsigned int col )
+{
+    pdlx->r[ pdlx->l[col] ] = pdlx->r[col];
+    pdlx->l[ pdlx->r[col] ] = pdlx->l[col];
+    
+    for( unsigned int i=pdlx->d[col]; i!=col; i=pdlx->d[i] )
+    {
+        for( unsigned int j=pdlx->r[i]; j!=i; j=pdlx->r[j] )
+        {
+            pdlx->u[ pdlx->d[j] ] = pdlx->u[j];
+            pdlx->d[ pdlx->u[j] ] = pdlx->d[j];
+            pdlx->size[ pdlx->c[j] ]--;
+        }
+    }
+}
+
+static void solverDlxUncover( SOLVER_DLX_S * pdlx, unsigned int col )
+{
+    for( unsigned int i=pdlx->u[col]; i!=col; i=pdlx->u[i] )
+    {
+        for( unsigned int j=pdlx->l[i]; j!=i; j=pdlx->l[j] )
+        {
+            pdlx->size[ pdlx->c[j] ]++;
+            pdlx->u[ pdlx->d[j] ] = j;
+            pdlx->d[ pdlx->u[j] ] = j;
+        }
+    }
+    pdlx->r[ pdlx->l[col] ] = col;
+    pdlx->l[ pdlx->r[col] ] = col;
+}
+
+static void solverDlxAddNode( SOLVER_DLX_S * pdlx, unsigned int node, unsigned int col, unsigned int placement )
+{
+    /*
+    ** Appends the node to the bottom of the column.
+    */
+    pdlx->c[node] = col;
+    pdlx->p[node] = placement;
+    pdlx->u[node] = pdlx->u[col];
+    pdlx->d[node] = col;
+    pdlx->d[ pdlx->u[col] ] = node;
+    pdlx->u[col] = node;
+    pdlx->size[col]++;
+}
+
+static int solverDlxBuild( SOLVER_CTX_S * pctx, const SUDOKU_S * psudoku )
+{
+    /*
+    ** Builds the cover matrix for the board.
+    ** Returns zero if the initial board breaks one of the constraints, in which case there
+    ** can be no solution.
+    */
+    SOLVER_DLX_S * pdlx = pctx->pdlx;
+    
+    unsigned int n     = pctx->n;
+    unsigned int nn    = pctx->nn;
+    unsigned int cells = nn * nn;
+    
+    pthread_once( &solver_once, solverInitEngines );
+    
+    unsigned short row_used[16] = {0};
+    unsigned short col_used[16] = {0};
+    unsigned short reg_used[16] = {0};
+    
+    for( unsigned int row=0; row<nn; row++ )
+    {
+        for( unsigned int col=0; col<nn; col++ )
+        {
+            unsigned int reg = solver_units[n][(row * nn) + col][2] - (2 * nn);
+            unsigned int bv  = psudoku->board[row][col];
+            
+            if( bv > 0 )
+            {
+                unsigned short val = 1 << (bv - 1);
+                
+                if( bv > nn || ((row_used[row] | col_used[col] | reg_used[reg]) & val) )
+                    return 0;
+                
+                row_used[row] |= val;
+                col_used[col] |= val;
+                reg_used[reg] |= val;
+            }
+        }
+    }
+    
+    /*
+    ** Constraints are numbered by kind, cell constraints first, then the row, column
+    ** and region constraints, each indexed by unit and value.
+    */
+    unsigned int cols = 0;
+    
+    pdlx->l[0] = 0;
+    pdlx->r[0] = 0;
+    
+    for( unsigned int con=0; con<4*cells; con++ )
+    {
+        unsigned int kind = con / cells;
+        unsigned int unit = (con % cells) / nn;
+        unsigned int val  = 1 << ((con % cells) % nn);
+        int          open = 0;
+        
+        switch( kind )
+        {
+            case 0: open = psudoku->board[unit][(con % cells) % nn] == 0; break;
+            case 1: open = (row_used[unit] & val) == 0; break;
+            case 2: open = (col_used[unit] & val) == 0; break;
+            case 3: open = (reg_used[unit] & val) == 0; break;
+        }
+        
+        pdlx->col_of[con] = 0;
+        
+        if( open )
+        {
+            unsigned int col = ++cols;
+            
+            pdlx->col_of[con] = col;
+            pdlx->size[col]   = 0;
+            pdlx->u[col]      = col;
+            pdlx->d[col]      = col;
+            pdlx->c[col]      = col;
+            pdlx->l[col]      = pdlx->l[0];
+            pdlx->r[col]      = 0;
+            pdlx->r[ pdlx->l[0] ] = col;
+            pdlx->l[0]        = col;
+        }
+    }
+    
+    unsigned int node = cols + 1;
+    
+    for( unsigned int row=0; row<nn; row++ )
+    {
+        for( unsigned int col=0; col<nn; col++ )
+        {
+            if( psudoku->board[row][col] > 0 )
+                continue;
+            
+            unsigned int cell = (row * nn) + col;
+            unsigned int reg  = solver_units[n][cell][2] - (2 * nn);
+            unsigned int free = ((1u << nn) - 1) & ~(row_used[row] | col_used[col] | reg_used[reg]);
+            
+            for( ; free!=0; free&=free-1 )
+            {
+                unsigned int v         = SOLVER_CTZ32( free );
+                unsigned int placement = (cell * 16) + v;
+                
+                solverDlxAddNode( pdlx, node+0, pdlx->col_of[ (0 * cells) + cell          ], placement );
+                solverDlxAddNode( pdlx, node+1, pdlx->col_of[ (1 * cells) + (row * nn) + v ], placement );
+                solverDlxAddNode( pdlx, node+2, pdlx->col_of[ (2 * cells) + (col * nn) + v ], placement );
+                solverDlxAddNode( pdlx, node+3, pdlx->col_of[ (3 * cells) + (reg * nn) + v ], placement );
+                
+                for( unsigned int i=0; i<4; i++ )
+                {
+                    pdlx->r[node+i] = node + ((i + 1) % 4);
+                    pdlx->l[node+i] = node + ((i + 3) % 4);
+                }
+                node += 4;
+            }
+        }
+    }
+    pdlx->node_count = node;
+    
+    return 1;
+}
+
+static int solverDlxSolve( SOLVER_CTX_S * pctx, const SUDOKU_S * psudoku, SUDOKU_S * solution )
+{
+    if( psudoku->n < 1 || psudoku->n > 4 )
+        return SOLVER_NO_SOLUTION;
+    
+    if( pctx->pdlx == NULL )
+    {
+        pctx->pdlx = (SOLVER_DLX_S *)malloc( sizeof(SOLVER_DLX_S) );
+        if( pctx->pdlx == NULL )
+            return SOLVER_EXHAUSTED;
+    }
+    
+    pctx->n  = psudoku->n;
+    pctx->nn = pctx->n * pctx->n;
+    
+    if( !solverDlxBuild( pctx, psudoku ) )
+        return SOLVER_NO_SOLUTION;
+    
+    SOLVER_DLX_S * pdlx  = pctx->pdlx;
+    unsigned int   level = 0;
+    
+    for( ;; )
+    {
+        if( pdlx->r[0] == 0 )
+        {
+            /*
+            ** Every constraint is covered, so the chosen rows form a solution.
+            */
+            for( unsigned int i=0; i<level; i++ )
+            {
+                unsigned int          placement = pdlx->p[ pdlx->choice[i] ];
+                const unsigned char * punit     = solver_units[pctx->n][placement / 16];
+                
+                solution->board[punit[0]][punit[1] - pctx->nn] = (placement % 16) + 1;
+            }
+            return SOLVER_SOLVED;
+        }
+        
+        /*
+        ** Choose the column with the fewest rows. A column with no rows cannot be covered,
+        ** which is caught below as soon as the column is tried.
+        */
+        unsigned int col  = pdlx->r[0];
+        unsigned int best = pdlx->size[col];
+        
+        for( unsigned int c=pdlx->r[col]; c!=0 && best>1; c=pdlx->r[c] )
+        {
+            if( pdlx->size[c] < best )
+            {
+                best = pdlx->size[c];
+                col  = c;
+            }
+        }
+        
+        solverDlxCover( pdlx, col );
+        
+        unsigned int node = pdlx->d[col];
+        
+        for( ;; )
+        {
+            if( node != col )
+            {
+                int stop = solverPollValue( pctx );
+                
+                if( stop != 0 )
+                    return stop;
+                
+                /*
+                ** Select the row, covering every other constraint it satisfies.
+                */
+                pdlx->choice[level++] = node;
+                
+                for( unsigned int j=pdlx->r[node]; j!=node; j=pdlx->r[j] )
+                {
+                    solverDlxCover( pdlx, pdlx->c[j] );
+                }
+                break;
+            }
+            
+            /*
+            ** All rows in this column have been tried. Backtrack to the previous level and
+            ** move on to its next row.
+            */
+            solverDlxUncover( pdlx, col );
+            
+            if( level == 0 )
+                return SOLVER_NO_SOLUTION;
+            
+            node = pdlx->choice[--level];
+            col  = pdlx->c[node];
+            
+            for( unsigned int j=pdlx->l[node]; j!=node; j=pdlx->l[j] )
+            {
+                solverDlxUncover( pdlx, pdlx->c[j] );
+            }
+            node = pdlx->d[node];
+        }
+    }
+}
+
+/*
+** EDITING
+**
+** Keeps the candidates of a board up to date while cells are filled in and cleared one at a
+** time, so the editor can check each change as it is made without setting up a whole solve.
+*/
+
+static void solverEditRefresh( SOLVER_EDIT_S * pedit, unsigned int cell )
+{
+    /*
+    ** Recomputes the candidates of one cell from the values in its units.
+    */
+    unsigned int          n     = pedit->board.n;
+    unsigned int          nn    = n * n;
+    const unsigned char * punit = solver_units[n][cell];
+    unsigned int          row   = punit[0];
+    unsigned int          col   = punit[1] - nn;
+    unsigned int          cand  = 0;
+    
+    if( pedit->board.board[row][col] == 0 )
+        cand = ((1 << nn) - 1) & ~(pedit->used[punit[0]] | pedit->used[punit[1]] | pedit->used[punit[2]]);
+    
+    if( pedit->board.board[row][col] == 0 && pedit->cand[cell] != 0 && cand == 0 )
+        pedit->blocked++;
+    if( pedit->board.board[row][col] == 0 && pedit->cand[cell] == 0 && cand != 0 )
+        pedit->blocked--;
+    
+    pedit->cand[cell] = cand;
+}
+
+static void solverEditRefreshPeers( SOLVER_EDIT_S * pedit, unsigned int row, unsigned int col )
+{
+    /*
+    ** Recomputes the candidates of every cell sharing a unit with the given cell. Cells in the
+    ** region are visited twice when they also share the row or column, which does no harm.
+    */
+    unsigned int          n     = pedit->board.n;
+    unsigned int          nn    = n * n;
+    const unsigned char * punit = solver_units[n][(row * nn) + col];
+    
+    for( unsigned int u=0; u<3; u++ )
+    {
+        const unsigned char * pcells = solver_unit_cells[n][punit[u]];
+        
+        for( unsigned int i=0; i<nn; i++ )
+        {
+            solverEditRefresh( pedit, pcells[i] );
+        }
+    }
+}
+
+static void solverEditCount( SOLVER_EDIT_S * pedit, unsigned int row, unsigned int col, unsigned int val, int add )
+{
+    /*
+    ** Adds or removes one copy of val in each unit of the given cell.
+    */
+    unsigned int          n     = pedit->board.n;
+    const unsigned char * punit = solver_units[n][(row * n * n) + col];
+    
+    for( int u=0; u<3; u++ )
+    {
+        unsigned char * pcount = &pedit->count[punit[u]][val - 1];
+        
+        if( add )
+        {
+            if( (*pcount)++ > 0 )
+                pedit->conflicts++;
+            pedit->used[punit[u]] |= 1 << (val - 1);
+        }
+        else
+        {
+            if( --(*pcount) > 0 )
+                pedit->conflicts--;
+            else
+                pedit->used[punit[u]] &= ~(1 << (val - 1));
+        }
+    }
+}
+
+static void solverBatchTask( POOL_S * ppool, int worker, POOL_TASK_S task )
+{
+    /*
+    ** Solves a range of boards from a batch.
+    ** Large ranges are halved first, pushing the upper half onto this worker's queue where
+    ** idle workers can steal it. The lower half is kept and split again until it is small.
+    */
+    SOLVER_BATCH_S * pbatch = (SOLVER_BATCH_S *)task.parg;
+    SOLVER_CTX_S *   pctx   = pbatch->ppctx[worker];
+    
+    while( task.hi - task.lo > SOLVER_BATCH_GRAIN )
+    {
+        POOL_TASK_S half = task;
+        
+        half.lo = task.lo + ((task.hi - task.lo) / 2);
+        task.hi = half.lo;
+        
+        poolSubmit( ppool, worker, half );
+    }
+    
+    for( size_t b=task.lo; b<task.hi; b++ )
+    {
+        sudokuClear( &pbatch->solution[b] );
+        pbatch->solution[b].n = pbatch->psudoku[b].n;
+        
+        /*
+        ** Once the batch is cancelled, the boards left are not started at all.
+        */
+        int result = SOLVER_CANCELLED;
+        
+        if( pbatch->opts.pcancel == NULL || !atomic_load_explicit( pbatch->opts.pcancel, memory_order_relaxed ) )
+            result = solverSolveEx( pctx, &pbatch->psudoku[b], &pbatch->solution[b], &pbatch->opts );
+        else
+            solverStatsClear( pctx );
+        
+        if( pbatch->status != NULL )
+            pbatch->status[b] = result;
+        
+        if( pbatch->stats != NULL )
+            pbatch->stats[b] = pctx->stats;
+        
+        if( result == SOLVER_SOLVED )
+            pbatch->psolved[worker]++;
+    }
+}
+
+
+/*
+** EXPORTED FUNCTIONS
+*/
+
+SOLVER_CTX_S * solverCtxCreate( void )
+{
+    SOLVER_CTX_S * pctx = (SOLVER_CTX_S *)malloc( sizeof(SOLVER_CTX_S) );
+    
+    if( pctx != NULL )
+    {
+        pctx->pdlx   = NULL;
+        pctx->plearn = NULL;
+        pctx->ptrace = NULL;
+        pctx->ptable = NULL;
+        pctx->backtrack_stack_size = 0;
+        solverCtxReset( pctx );
+        solverStatsClear( pctx );
+        
+        SUDOKU_S empty;
+        
+        sudokuClear( &empty );
+        empty.n = 3;
+        solverEditStart( pctx, &empty );
+    }
+    return pctx;
+}
+
+void solverCtxReset( SOLVER_CTX_S * pctx )
+{
+    /*
+    ** Only the counters need to be cleared. The arrays are always rebuilt from the board
+    ** at the start of each solve.
+    */
+    pctx->backtrack_stack_top  = 0;
+    pctx->backtrack_stack_peak = 0;
+    pctx->exhausted            = 0;
+    pctx->decision_stack_top   = 0;
+    pctx->candidate_count      = 0;
+    pctx->search_state        = SOLVER_SEARCH_NONE;
+    solverCtxOpts( pctx, NULL );
+    solverLimitsSet( pctx, NULL, 0 );
+    pctx->n  = 0;
+    pctx->nn = 0;
+}
+
+void solverCtxDestroy( SOLVER_CTX_S * pctx )
+{
+    if( pctx != NULL )
+    {
+        for( unsigned int chunk=0; chunk<((pctx->backtrack_stack_size + SOLVER_TRAIL_CHUNK_MASK) >> SOLVER_TRAIL_CHUNK_SHIFT); chunk++ )
+        {
+            free( pctx->backtrack_chunk[chunk] );
+        }
+        free( pctx->pdlx );
+        free( pctx->plearn );
+        free( pctx );
+    }
+}
+
+size_t solverCtxTrailPeak( const SOLVER_CTX_S * pctx )
+{
+    return pctx->backtrack_stack_peak * sizeof(SOLVER_BACKTRACK_S);
+}
+
+void solverCtxStats( const SOLVER_CTX_S * pctx, SOLVER_STATS_S * pstats )
+{
+    *pstats = pctx->stats;
+}
+
+SOLVER_TRACE_S * solverTraceCreate( size_t max_bytes )
+{
+    SOLVER_TRACE_S * ptrace = (SOLVER_TRACE_S *)malloc( sizeof(SOLVER_TRACE_S) );
+    
+    if( ptrace != NULL )
+    {
+        ptrace->data      = NULL;
+        ptrace->capacity  = 0;
+        ptrace->max_bytes = max_bytes;
+        solverTraceClear( ptrace );
+    }
+    return ptrace;
+}
+
+void solverTraceClear( SOLVER_TRACE_S * ptrace )
+{
+    ptrace->size      = 0;
+    ptrace->events    = 0;
+    ptrace->cell      = 0;
+    ptrace->truncated = 0;
+}
+
+void solverTraceDestroy( SOLVER_TRACE_S * ptrace )
+{
+    if( ptrace != NULL )
+    {
+        free( ptrace->data );
+        free( ptrace );
+    }
+}
+
+const unsigned char * solverTraceData( const SOLVER_TRACE_S * ptrace, size_t * psize )
+{
+    *psize = ptrace->size;
+    return ptrace->data;
+}
+
+unsigned long long solverTraceEvents( const SOLVER_TRACE_S * ptrace )
+{
+    return ptrace->events;
+}
+
+int solverTraceTruncated( const SOLVER_TRACE_S * ptrace )
+{
+    return ptrace->truncated;
+}
+
+void solverCtxTrace( SOLVER_CTX_S * pctx, SOLVER_TRACE_S * ptrace )
+{
+#if SOLVER_TRACE
+    pctx->ptrace = ptrace;
+#else
+    (void)pctx;
+    (void)ptrace;
+#endif
+}
+
+SOLVER_TABLE_S * solverTableCreate( size_t max_bytes )
+{
+    SOLVER_TABLE_S * ptable  = (SOLVER_TABLE_S *)malloc( sizeof(SOLVER_TABLE_S) );
+    size_t           buckets = 1;
+    
+    if( ptable == NULL )
+        return NULL;
+    
+    while( buckets * 2 * SOLVER_TABLE_WAYS * sizeof(uint64_t) <= max_bytes )
+        buckets *= 2;
+    
+    ptable->slot = (_Atomic uint64_t *)calloc( buckets * SOLVER_TABLE_WAYS, sizeof(uint64_t) );
+    ptable->mask = buckets - 1;
+    
+    if( ptable->slot == NULL )
+    {
+        free( ptable );
+        return NULL;
+    }
+    return ptable;
+}
+
+void solverTableClear( SOLVER_TABLE_S * ptable )
+{
+    for( size_t i=0; i<(ptable->mask + 1) * SOLVER_TABLE_WAYS; i++ )
+        atomic_store_explicit( &ptable->slot[i], 0, memory_order_relaxed );
+}
+
+void solverTableDestroy( SOLVER_TABLE_S * ptable )
+{
+    if( ptable != NULL )
+    {
+        free( (void *)ptable->slot );
+        free( ptable );
+    }
+}
+
+size_t solverTableBytes( const SOLVER_TABLE_S * ptable )
+{
+    return (ptable->mask + 1) * SOLVER_TABLE_WAYS * sizeof(uint64_t);
+}
+
+void solverCtxTable( SOLVER_CTX_S * pctx, SOLVER_TABLE_S * ptable )
+{
+    pctx->ptable = ptable;
+}
+
+void solverTraceReaderInit( SOLVER_TRACE_READER_S * preader, const unsigned char * data, size_t size )
+{
+    preader->data = data;
+    preader->end  = data + size;
+    preader->cell = 0;
+}
+
+int solverTraceRead( SOLVER_TRACE_READER_S * preader, SOLVER_TRACE_EVENT_S * pevent )
+{
+    if( preader->data >= preader->end )
+        return 0;
+    
+    unsigned int header = *preader->data++;
+    unsigned int varint = 0;
+    unsigned int shift  = 0;
+    
+    while( preader->data < preader->end )
+    {
+        unsigned int byte = *preader->data++;
+        
+        varint |= (byte & 0x7F) << shift;
+        shift  += 7;
+        
+        if( (byte & 0x80) == 0 )
+            break;
+    }
+    
+    pevent->type = header >> 4;
+    
+    if( pevent->type == SOLVER_TRACE_BACKTRACK )
+    {
+        pevent->depth = varint;
+        pevent->value = 0;
+        pevent->cell  = preader->cell;
+        return 1;
+    }
+    
+    int delta = (varint & 1) ? -(int)((varint + 1) >> 1) : (int)(varint >> 1);
+    
+    preader->cell += delta;
+    
+    pevent->depth = 0;
+    pevent->value = (header & 0x0F) + 1;
+    pevent->cell  = preader->cell;
+    return 1;
+}
+
+void solverEditStart( SOLVER_CTX_S * pctx, const SUDOKU_S * psudoku )
+{
+    SOLVER_EDIT_S * pedit = &pctx->edit;
+    
+    unsigned int n  = (psudoku->n >= 1 && psudoku->n <= 4) ? psudoku->n : 3;
+    unsigned int nn = n * n;
+    
+    pthread_once( &solver_once, solverInitEngines );
+    
+    sudokuClear( &pedit->board );
+    pedit->board.n   = n;
+    pedit->conflicts = 0;
+    pedit->blocked   = 0;
+    
+    for( unsigned int unit=0; unit<3*nn; unit++ )
+    {
+        pedit->used[unit] = 0;
+        
+        for( unsigned int val=0; val<nn; val++ )
+        {
+            pedit->count[unit][val] = 0;
+        }
+    }
+    
+    for( unsigned int row=0; row<nn; row++ )
+    {
+        for( unsigned int col=0; col<nn; col++ )
+        {
+            unsigned int val = psudoku->board[row][col];
+            
+            if( val >= 1 && val <= nn )
+            {
+                pedit->board.board[row][col] = val;
+                solverEditCount( pedit, row, col, val, 1 );
+            }
+            pedit->cand[(row * nn) + col] = ~0; /* Not blocked yet, so the refresh below counts it */
+        }
+    }
+    
+    for( unsigned int cell=0; cell<nn*nn; cell++ )
+    {
+        solverEditRefresh( pedit, cell );
+    }
+}
+
+int solverAssign( SOLVER_CTX_S * pctx, unsigned int row, unsigned int col, unsigned int val )
+{
+    SOLVER_EDIT_S * pedit = &pctx->edit;
+    
+    unsigned int nn = pedit->board.n * pedit->board.n;
+    
+    if( row < nn && col < nn && val >= 1 && val <= nn )
+    {
+        unsigned int cell = (row * nn) + col;
+        
+        if( pedit->board.board[row][col] != 0 )
+            solverEditCount( pedit, row, col, pedit->board.board[row][col], 0 );
+        else if( pedit->cand[cell] == 0 )
+            pedit->blocked--; /* A filled cell is never blocked */
+        
+        pedit->board.board[row][col] = val;
+        pedit->cand[cell]            = 0;
+        
+        solverEditCount( pedit, row, col, val, 1 );
+        solverEditRefreshPeers( pedit, row, col );
+    }
+    return solverEditConsistent( pctx );
+}
+
+int solverUnassign( SOLVER_CTX_S * pctx, unsigned int row, unsigned int col )
+{
+    SOLVER_EDIT_S * pedit = &pctx->edit;
+    
+    unsigned int nn = pedit->board.n * pedit->board.n;
+    
+    if( row < nn && col < nn && pedit->board.board[row][col] != 0 )
+    {
+        solverEditCount( pedit, row, col, pedit->board.board[row][col], 0 );
+        
+        pedit->board.board[row][col] = 0;
+        pedit->cand[(row * nn) + col] = ~0;
+        
+        solverEditRefreshPeers( pedit, row, col );
+    }
+    return solverEditConsistent( pctx );
+}
+
+unsigned int solverCandidates( const SOLVER_CTX_S * pctx, unsigned int row, unsigned int col )
+{
+    unsigned int nn = pctx->edit.board.n * pctx->edit.board.n;
+    
+    if( row >= nn || col >= nn )
+        return 0;
+    
+    return pctx->edit.cand[(row * nn) + col];
+}
+
+int solverConflicts( const SOLVER_CTX_S * pctx, unsigned int row, unsigned int col )
+{
+    const SOLVER_EDIT_S * pedit = &pctx->edit;
+    
+    unsigned int n  = pedit->board.n;
+    unsigned int nn = n * n;
+    
+    if( row >= nn || col >= nn || pedit->board.board[row][col] == 0 )
+        return 0;
+    
+    const unsigned char * punit = solver_units[n][(row * nn) + col];
+    unsigned int          val   = pedit->board.board[row][col] - 1;
+    
+    return pedit->count[punit[0]][val] > 1 || pedit->count[punit[1]][val] > 1 || pedit->count[punit[2]][val] > 1;
+}
+
+int solverEditConsistent( const SOLVER_CTX_S * pctx )
+{
+    return pctx->edit.conflicts == 0 && pctx->edit.blocked == 0;
+}
+
+const SUDOKU_S * solverEditBoard( const SOLVER_CTX_S * pctx )
+{
+    return &pctx->edit.board;
+}
+
+void solverCtxOpts( SOLVER_CTX_S * pctx, const SOLVER_OPTS_S * popts )
+{
+    SOLVER_OPTS_S opts;
+    
+    if( popts == NULL )
+    {
+        solverOptsInit( &opts );
+        popts = &opts;
+    }
+    
+    pctx->level        = popts->level;
+    pctx->probe_max    = popts->probe_max;
+    pctx->learn_max    = popts->learn_max;
+    pctx->restart_base = popts->restart_base;
+    pctx->learning     = 0;
+    
+    solverRandomSeed( pctx, popts->seed );
+}
+
+void solverOptsInit( SOLVER_OPTS_S * popts )
+{
+    popts->backend       = SOLVER_BACKEND_PRUNE;
+    popts->threads       = 1;
+    popts->node_limit    = 0;
+    popts->time_limit_ns = 0;
+    popts->pcancel       = NULL;
+    popts->level         = SOLVER_LEVEL_SINGLES;
+    popts->probe_max     = 0;
+    popts->learn_max     = 0;
+    popts->restart_base  = 0;
+    popts->seed          = 0;
+}
+
+int solverSolveEx(
+    SOLVER_CTX_S *        pctx,
+    const SUDOKU_S *      psudoku,
+    SUDOKU_S *            solution,
+    const SOLVER_OPTS_S * popts
+    ) {
+    SOLVER_OPTS_S opts;
+    
+    if( popts == NULL )
+    {
+        solverOptsInit( &opts );
+        popts = &opts;
+    }
+    
+    solverStatsClear( pctx );
+    
+    unsigned long long start = SOLVER_STAT_NOW();
+    int                result;
+    
+    solverCtxOpts( pctx, popts );
+    solverLimitsSet( pctx, popts, 1 );
+    
+    switch( popts->backend )
+    {
+        case SOLVER_BACKEND_DLX:
+            result = solverDlxSolve( pctx, psudoku, solution );
+            SOLVER_STAT_TIME( pctx, search_ns, start ); /* The other backends keep no counters */
+            break;
+            
+        case SOLVER_BACKEND_BITBOARD:
+            if( psudoku->n == 3 )
+            {
+                /*
+                ** The limits are only checked if there are any, so an unlimited solve runs
+                ** without the call for every value tried.
+                */
+                result = solverBBSolve( psudoku, solution, (pctx->poll_next != ~0ull) ? solverPollBB : NULL, pctx );
+                SOLVER_STAT_TIME( pctx, search_ns, start );
+                break;
+            }
+            result = solverPruneSolve( pctx, psudoku, solution );
+            break;
+            
+        case SOLVER_BACKEND_PRUNE:
+        default:
+            if( popts->threads != 1 )
+                result = solverParallelSolve( pctx, psudoku, solution, popts->threads );
+            else
+                result = solverPruneSolve( pctx, psudoku, solution );
+            break;
+    }
+    
+    solverLimitsSet( pctx, NULL, 0 ); /* The limits are for this solve only, while the options stay */
+    
+    return result;
+}
+
+int solverSolveCtx( SOLVER_CTX_S * pctx, const SUDOKU_S * psudoku, SUDOKU_S * solution ) {
+    solverStatsClear( pctx );
+    solverLimitsSet( pctx, NULL, 1 );
+    
+    return solverPruneSolve( pctx, psudoku, solution );
+}
+
+int solverSolve( const SUDOKU_S * psudoku, SUDOKU_S * solution ) {
+    /*
+    ** Solves the board using a single shared context.
+    ** Only one call can be in progress at a time. Use solverSolveCtx with a context per thread
+    ** to solve boards concurrently.
+    */
+    int result = solverSolveCtx( &solver_ctx, psudoku, solution );
+    
+    if( result == SOLVER_SOLVED )
+    {
+        SW_INFO("Algorithm complete");
+    }
+    else if( result == SOLVER_EXHAUSTED )
+    {
+        SW_INFO("Solver ran out of memory");
+    }
+    else if( result == SOLVER_TIMEOUT || result == SOLVER_CANCELLED )
+    {
+        SW_INFO("Solver stopped early");
+    }
+    else
+    {
+        SW_INFO("No solution exists");
+    }
+    return result;
+}
+
+unsigned long long solverCountSolutionsCtx(
+    SOLVER_CTX_S *     pctx,
+    const SUDOKU_S *   psudoku,
+    unsigned long long limit,
+    SUDOKU_S *         solutions
+    ) {
+    solverStatsClear( pctx );
+    solverLimitsSet( pctx, NULL, 1 );
+    
+    return solverPruneCount( pctx, psudoku, limit, solutions );
+}
+
+unsigned long long solverCountSolutions( const SUDOKU_S * psudoku, unsigned long long limit, SUDOKU_S * solutions ) {
+    return solverCountSolutionsCtx( &solver_ctx, psudoku, limit, solutions );
+}
+
+void solverStart( SOLVER_CTX_S * pctx, const SUDOKU_S * psudoku )
+{
+    solverStatsClear( pctx );
+    
+    if( solverPruneStart( pctx, psudoku ) || pctx->exhausted )
+        pctx->search_state = SOLVER_SEARCH_READY;
+    else
+        pctx->search_state = SOLVER_SEARCH_DONE;
+}
+
+int solverStep( SOLVER_CTX_S * pctx, unsigned int budget_us, SUDOKU_S * solution )
+{
+    /*
+    ** Everything needed to carry on is already in the context: the decision stack says which
+    ** values are left to try, and the backtracking stack says how to undo the current path.
+    ** A step that runs out of time stops just before trying a value, which is exactly where a
+    ** resumed search starts, so pausing and resuming a step works the same way as moving on
+    ** from a solution. Steps never restart, since the restart schedule would start over with
+    ** every step.
+    */
+    if( pctx->search_state != SOLVER_SEARCH_READY &&
+        pctx->search_state != SOLVER_SEARCH_FOUND &&
+        pctx->search_state != SOLVER_SEARCH_PAUSED )
+    {
+        return SOLVER_NO_SOLUTION;
+    }
+    
+    if( pctx->exhausted )
+        return SOLVER_EXHAUSTED;
+    
+    if( budget_us != 0 )
+    {
+        SOLVER_OPTS_S opts;
+        
+        solverOptsInit( &opts );
+        opts.time_limit_ns = (unsigned long long)budget_us * 1000ull;
+        
+        solverLimitsSet( pctx, &opts, 0 );
+        pctx->poll_interval = SOLVER_STEP_POLL_INTERVAL;
+        pctx->poll_next     = SOLVER_STEP_POLL_INTERVAL; /* Every step gets somewhere, however small its budget */
+    }
+    else
+        solverLimitsSet( pctx, NULL, 0 );
+    
+    int result = solverSearch( pctx, pctx->search_state != SOLVER_SEARCH_READY );
+    
+    solverLimitsSet( pctx, NULL, 0 );
+    
+    if( result == SOLVER_TIMEOUT )
+    {
+        pctx->search_state = SOLVER_SEARCH_PAUSED;
+        return SOLVER_IN_PROGRESS;
+    }
+    
+    if( result != SOLVER_SOLVED )
+    {
+        pctx->search_state = SOLVER_SEARCH_DONE;
+        return result;
+    }
+    
+    pctx->search_state = SOLVER_SEARCH_FOUND;
+    solverPruneFillAll( pctx, solution );
+    
+    return SOLVER_SOLVED;
+}
+
+int solverNext( SOLVER_CTX_S * pctx, SUDOKU_S * solution )
+{
+    return solverStep( pctx, 0, solution );
+}
+
+unsigned long long solverEnumerate(
+    SOLVER_CTX_S *       pctx,
+    const SUDOKU_S *     psudoku,
+    SOLVER_SOLUTION_FN * pfunc,
+    void *               parg
+    ) {
+    unsigned long long count = 0;
+    SUDOKU_S           solution;
+    
+    solverStart( pctx, psudoku );
+    
+    while( solverNext( pctx, &solution ) == SOLVER_SOLVED )
+    {
+        count++;
+        
+        if( pfunc( &solution, parg ) != 0 )
+        {
+            pctx->search_state = SOLVER_SEARCH_DONE;
+            break;
+        }
+    }
+    return count;
+}
+
+int solverCountSolutionsParallel(
+    const SUDOKU_S *     psudoku,
+    unsigned long long * pcount,
+    int                  threads,
+    SOLVER_PROGRESS_FN * pfunc,
+    void *               parg
+    ) {
+    if( threads <= 0 )
+        threads = poolCpuCount();
+    
+    SOLVER_CTX_S *     ctx_a  [ threads ];
+    unsigned long long count_a[ threads ];
+    
+    int result = 0;
+    
+    for( int w=0; w<threads; w++ )
+    {
+        ctx_a  [w] = solverCtxCreate();
+        count_a[w] = 0;
+        
+        if( ctx_a[w] == NULL )
+            result = -1;
+    }
+    
+    SUDOKU_S *         psubtree = (SUDOKU_S *)malloc( SOLVER_COUNT_MAX_SUBTREES * sizeof(SUDOKU_S) );
+    unsigned long long root     = 0;
+    
+    if( psubtree == NULL )
+        result = -1;
+    
+    if( result == 0 )
+    {
+        SOLVER_COUNT_S job;
+        
+        job.psubtree = psubtree;
+        job.ppctx    = ctx_a;
+        job.pcount   = count_a;
+        job.done      = 0;
+        job.exhausted = 0;
+        job.total     = solverCountSplit( ctx_a[0], psudoku, psubtree, &root, &job.exhausted );
+        job.found    = root;
+        job.pfunc    = pfunc;
+        job.parg     = parg;
+        pthread_mutex_init( &job.mutex, NULL );
+        
+        POOL_TASK_S task = { solverCountTask, &job, 0, job.total };
+        
+        if( job.total == 0 )
+        {
+            /* Nothing left to count */
+        }
+        else if( threads == 1 )
+        {
+            for( size_t t=0; t<job.total; t++ )
+            {
+                task.lo = t;
+                task.hi = t+1;
+                solverCountTask( NULL, 0, task );
+            }
+        }
+        else
+        {
+            POOL_S * ppool = poolCreate( threads );
+            
+            if( ppool != NULL )
+            {
+                poolSubmit( ppool, -1, task );
+                poolWait( ppool );
+                poolDestroy( ppool );
+            }
+            else
+            {
+                result = -1;
+            }
+        }
+        pthread_mutex_destroy( &job.mutex );
+        
+        if( job.exhausted )
+            result = -1;
+    }
+    
+    if( result == 0 )
+    {
+        *pcount = root;
+        for( int w=0; w<threads; w++ )
+        {
+            *pcount += count_a[w];
+        }
+    }
+    
+    free( psubtree );
+    for( int w=0; w<threads; w++ )
+    {
+        solverCtxDestroy( ctx_a[w] );
+    }
+    return result;
+}
+
+int solverSolveBatch(
+    const SUDOKU_S *      psudoku,
+    SUDOKU_S *            solution,
+    int *                 status,
+    SOLVER_STATS_S *      stats,
+    size_t                count,
+    int                   threads,
+    const SOLVER_OPTS_S * popts
+    ) {
+    if( threads <= 0 )
+        threads = poolCpuCount();
+    
+    if( count == 0 )
+        return 0;
+    
+    SOLVER_CTX_S * ctx_a   [ threads ];
+    int            solved_a[ threads ];
+    
+    int result = 0;
+    
+    for( int w=0; w<threads; w++ )
+    {
+        ctx_a   [w] = solverCtxCreate();
+        solved_a[w] = 0;
+        
+        if( ctx_a[w] == NULL )
+            result = -1;
+    }
+    
+    SOLVER_OPTS_S opts;
+    
+    if( popts != NULL )
+        opts = *popts;
+    else
+        solverOptsInit( &opts );
+    
+    opts.threads = 1; /* The workers already keep every processor busy */
+    
+    SOLVER_BATCH_S batch = { psudoku, solution, status, stats, ctx_a, solved_a, opts };
+    POOL_TASK_S    task  = { solverBatchTask, &batch, 0, count };
+    
+    if( result == 0 )
+    {
+        if( threads == 1 )
+        {
+            /*
+            ** No point starting a thread just to wait for it.
+            */
+            for( size_t b=0; b<count; b++ )
+            {
+                task.lo = b;
+                task.hi = b+1;
+                solverBatchTask( NULL, 0, task );
+            }
+        }
+        else
+        {
+            POOL_S * ppool = poolCreate( threads );
+            
+            if( ppool != NULL )
+            {
+                poolSubmit ( ppool, -1, task );
+                poolWait   ( ppool );
+                poolDestroy( ppool );
+            }
+            else
+            {
+                result = -1;
+            }
+        }
+    }
+    
+    for( int w=0; w<threads; w++ )
+    {
+        if( result >= 0 )
+            result += solved_a[w];
+        
+        solverCtxDestroy( ctx_a[w] );
+    }
+    return result;
+}
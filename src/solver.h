@@ -5,8 +5,574 @@
 ** For details of the algorithm, see the source file.
 */
 
+#include <stddef.h>
+#include <stdatomic.h>
+
 #include "sudoku.h"
 
+/*
+** DEFINITIONS
+*/
+
+enum
+{
+    SOLVER_NO_SOLUTION = 0,
+    SOLVER_SOLVED      = 1,
+    SOLVER_EXHAUSTED   = 2,
+    SOLVER_TIMEOUT     = 3,
+    SOLVER_CANCELLED   = 4,
+    SOLVER_IN_PROGRESS = 5
+};
+        /*
+        ** Result of a solve.
+        ** SOLVER_EXHAUSTED means the solve needed more memory than it was allowed, or than could be
+        ** allocated, and stopped without an answer.
+        ** SOLVER_TIMEOUT and SOLVER_CANCELLED mean the solve reached a limit set in SOLVER_OPTS_S
+        ** and stopped without an answer. Whether the board has a solution is still unknown.
+        ** SOLVER_IN_PROGRESS is only returned by solverStep, and means the search can carry on.
+        */
+
+enum
+{
+    SOLVER_BACKEND_PRUNE = 0,
+        /*
+        ** Backtracking over a candidate list, pruning candidate values as they are used.
+        */
+    SOLVER_BACKEND_DLX,
+        /*
+        ** Exact cover search using dancing links. Always branches on the most constrained
+        ** constraint, which makes it much less sensitive to unlucky boards.
+        */
+    SOLVER_BACKEND_BITBOARD
+        /*
+        ** Specialized solver for 9x9 boards using one 81 bit mask per value. Other board sizes
+        ** use SOLVER_BACKEND_PRUNE. The masks are processed with SSE2 when the compiler targets
+        ** x86-64 and NEON when it targets ARM, and with plain 64 bit integers otherwise. The
+        ** choice is made at compile time, not by asking the processor, and there is no AVX2
+        ** version.
+        */
+};
+
+enum
+{
+    SOLVER_LEVEL_SINGLES = 0,
+        /*
+        ** Naked and hidden singles only: cells with one value left, and values with one cell
+        ** left in a unit.
+        */
+    SOLVER_LEVEL_LOCKED,
+        /*
+        ** Adds locked candidates: values confined to where a region and a row or column cross
+        ** are removed from the rest of the other unit.
+        */
+    SOLVER_LEVEL_SUBSETS,
+        /*
+        ** Adds naked and hidden pairs and triples within each unit.
+        */
+    SOLVER_LEVEL_FISH
+        /*
+        ** Adds X-wings: a value confined to the same two columns of two rows, or the other way
+        ** around.
+        */
+};
+
+struct _SOLVER_OPTS_S
+{
+    int backend; /* One of the SOLVER_BACKEND values */
+    int threads;
+        /*
+        ** Number of threads searching the board, for SOLVER_BACKEND_PRUNE. The default of 1
+        ** searches on the calling thread. Zero or less uses one thread per processor.
+        **
+        ** With more than one thread, the search tree is split a few levels down and the parts are
+        ** searched at the same time, stopping as soon as any of them finds a solution. A board with
+        ** several solutions may give a different one from run to run.
+        */
+    unsigned long long node_limit;
+        /*
+        ** Most values the search may try before giving up with SOLVER_TIMEOUT. Zero, the
+        ** default, means no limit. With more than one thread the limit applies to each thread.
+        */
+    unsigned long long time_limit_ns;
+        /*
+        ** Most time the solve may take, in nanoseconds, before giving up with SOLVER_TIMEOUT.
+        ** Zero, the default, means no limit. The clock is checked every few hundred values tried,
+        ** so a solve can run over by a few microseconds.
+        */
+    const atomic_int * pcancel;
+        /*
+        ** If set, the solve gives up with SOLVER_CANCELLED soon after another thread sets the
+        ** token to a non-zero value. NULL by default.
+        */
+    int level;
+        /*
+        ** How hard SOLVER_BACKEND_PRUNE works at each step of the search before it picks a cell
+        ** to branch on, one of the SOLVER_LEVEL values. Stronger propagation costs more at each
+        ** step but can make the search tree far smaller. The default of SOLVER_LEVEL_SINGLES is
+        ** fastest on 9x9 boards, while SOLVER_LEVEL_LOCKED can be thousands of times faster on
+        ** hard 16x16 boards. The -L option of tools/solver_cli.c compares the levels on a set of
+        ** boards.
+        */
+    unsigned int probe_max;
+        /*
+        ** Look-ahead for SOLVER_BACKEND_PRUNE. Before branching on a cell with at most this many
+        ** values, each value is tried and propagated, and those that fail straight away are
+        ** removed. 2 or 3 cuts the values tried sharply on the hardest boards. The default of 0
+        ** turns it off.
+        */
+    unsigned int learn_max;
+        /*
+        ** Nogood learning for SOLVER_BACKEND_PRUNE, keeping up to this many nogoods. Each dead end
+        ** is traced back to the placements that caused it, which are stored as a nogood that can
+        ** never hold again, and the search jumps straight back to the latest decision involved.
+        ** Once the store is full, the nogood used longest ago makes way for the next. Around 1000
+        ** to 10000 suits large boards. The default of 0 turns it off and backtracks one decision
+        ** at a time.
+        **
+        ** Values removed by the levels above SOLVER_LEVEL_SINGLES or by probing are blamed on
+        ** every decision above them, which makes for weaker nogoods, so learning gains most with
+        ** SOLVER_LEVEL_SINGLES or SOLVER_LEVEL_LOCKED and no probing.
+        */
+    unsigned int restart_base;
+        /*
+        ** Randomized restarts for SOLVER_BACKEND_PRUNE. The search starts over from the top after
+        ** restart_base values tried, then after the same again times each term of the Luby
+        ** sequence 1 1 2 1 1 2 4 1 ..., branching on cells and values in a new random order each
+        ** time. Conflicts are counted per cell across restarts, and cells with more of them are
+        ** branched on first. This cuts the rare very slow solves on large boards, and a few
+        ** hundred is a good start. Learned nogoods are kept across restarts. The default of 0
+        ** turns it off, so the search is the same every time.
+        */
+    unsigned long long seed;
+        /*
+        ** Seeds the random choices made with restart_base set. The same board, options and seed
+        ** always give the same search. Parallel solves seed each thread differently from it.
+        */
+};
+typedef struct _SOLVER_OPTS_S SOLVER_OPTS_S;
+        /*
+        ** Options controlling a solve.
+        ** Always initialize with solverOptsInit before changing individual fields, so that
+        ** any fields added later get sensible defaults.
+        **
+        ** The limits only apply to the solve they are given to. The search options, level through
+        ** seed, stay on the context for every later search made with it, including counts,
+        ** enumerations and steps, until solverSolveEx or solverCtxOpts changes them.
+        **
+        ** Every backend checks the limits. SOLVER_BACKEND_DLX counts each row of the cover matrix
+        ** it tries as a value.
+        */
+
+#define SOLVER_STATS_DEPTHS 32
+
+struct _SOLVER_STATS_S
+{
+    unsigned long long nodes;       /* Values tried at decisions */
+    unsigned long long assignments; /* Values placed, by decisions and by propagation */
+    unsigned long long backtracks;
+        /*
+        ** Dead ends, counting both values that failed as soon as they were tried and decisions
+        ** that ran out of values.
+        */
+    unsigned long long prunes;      /* Values removed from open cells */
+    unsigned long long probes;      /* Values tried and undone again by look-ahead */
+    unsigned long long learned;     /* Nogoods stored by learning */
+    unsigned long long backjumps;   /* Decisions jumped over by learning, on top of plain backtracking */
+    unsigned long long restarts;    /* Times the search started over from the top */
+    unsigned long long table_hits;   /* States found in the table, and so not searched again */
+    unsigned long long table_misses; /* States looked up in the table and not found */
+    unsigned long long table_stores; /* States stored in the table */
+    unsigned int       trail_peak;  /* Most entries on the backtracking stack at once */
+    unsigned int       depth_peak;  /* Most decisions on the path at once */
+    
+    unsigned long long decisions[ SOLVER_STATS_DEPTHS ];
+    unsigned long long branches [ SOLVER_STATS_DEPTHS ];
+        /*
+        ** Branching histogram. decisions[d] counts the decisions made with d decisions above
+        ** them, and branches[d] the values or places they had to choose from, so branches[d] / decisions[d]
+        ** is the average branching factor at that depth. Deeper decisions share the last entry.
+        */
+    
+    unsigned long long setup_ns;    /* Reading the board */
+    unsigned long long candgen_ns;  /* Generating the candidate values */
+    unsigned long long sort_ns;     /* Ordering the cells, which fills the buckets */
+    unsigned long long search_ns;   /* Propagation and search */
+};
+typedef struct _SOLVER_STATS_S SOLVER_STATS_S;
+        /*
+        ** Statistics of a solve, count or enumeration, for finding out why one was slow.
+        ** Counters are kept by SOLVER_BACKEND_PRUNE. The other backends only fill in search_ns,
+        ** with the time of the whole solve. A parallel solve adds up the counters and times of
+        ** every worker.
+        **
+        ** Builds of solver.c with SOLVER_STATS defined as 0 keep no statistics at all, and
+        ** every field reads as zero.
+        */
+
+enum
+{
+    SOLVER_TRACE_DECIDE    = 0, /* A value tried at a decision */
+    SOLVER_TRACE_ASSIGN    = 1, /* A value placed by propagation */
+    SOLVER_TRACE_PRUNE     = 2, /* A value removed from an open cell */
+    SOLVER_TRACE_BACKTRACK = 3  /* Everything since a value was tried at the given depth undone */
+};
+
+struct _SOLVER_TRACE_EVENT_S
+{
+    unsigned int type;  /* One of SOLVER_TRACE_... */
+    unsigned int cell;  /* row * n * n + col. The cell of the last event, for a backtrack */
+    unsigned int value; /* 1 to n * n, or 0 for a backtrack */
+    unsigned int depth; /* Decisions still on the path, for a backtrack */
+};
+typedef struct _SOLVER_TRACE_EVENT_S SOLVER_TRACE_EVENT_S;
+
+struct _SOLVER_TRACE_READER_S
+{
+    const unsigned char * data;
+    const unsigned char * end;
+    unsigned int          cell;
+};
+typedef struct _SOLVER_TRACE_READER_S SOLVER_TRACE_READER_S;
+        /*
+        ** Walks through the events of a trace. The fields are private to the reader functions.
+        */
+
+typedef struct _SOLVER_TRACE_S SOLVER_TRACE_S;
+        /*
+        ** Opaque search trace.
+        ** Records what a search did, one event for each value tried, placed or pruned and for each
+        ** dead end, in a compact binary form that takes about two bytes per event.
+        */
+
+typedef struct _SOLVER_TABLE_S SOLVER_TABLE_S;
+        /*
+        ** Opaque transposition table.
+        ** Remembers board states that a search has found to have no solution, so that a search
+        ** reaching one again, by placing the same values in another order, backtracks at once.
+        */
+
+typedef struct _SOLVER_CTX_S SOLVER_CTX_S;
+        /*
+        ** Opaque solver context.
+        ** Holds all of the working state for a solve. A context can only be used by one solve
+        ** at a time, but separate contexts can be used concurrently from separate threads.
+        */
+
+typedef int SOLVER_SOLUTION_FN( const SUDOKU_S * solution, void * parg );
+        /*
+        ** Receives each solution from solverEnumerate. The solution is only valid during the call.
+        ** Return zero to carry on with the next solution, or non-zero to stop.
+        */
+
+
+/*
+** PUBLIC FUNCTIONS
+*/
+
+SOLVER_CTX_S * solverCtxCreate ( void );
+void           solverCtxReset  ( SOLVER_CTX_S * pctx );
+void           solverCtxDestroy( SOLVER_CTX_S * pctx );
+        /*
+        ** Creates, resets and destroys a solver context.
+        ** Most of the memory used by a solve is allocated when the context is created. The
+        ** backtracking stack grows in chunks as needed and is kept for later solves, so a context
+        ** that is reused soon stops allocating altogether.
+        ** solverCtxCreate returns NULL if the memory could not be allocated.
+        */
+
+size_t solverCtxTrailPeak( const SOLVER_CTX_S * pctx );
+        /*
+        ** Returns the most memory, in bytes, that the backtracking stack has held at once since
+        ** the context was created or reset.
+        */
+
+void solverCtxStats( const SOLVER_CTX_S * pctx, SOLVER_STATS_S * pstats );
+        /*
+        ** Fills in the statistics of the last solve, count or enumeration made with the context.
+        ** An enumeration carries on adding to them with each call to solverNext.
+        */
+
+SOLVER_TRACE_S * solverTraceCreate ( size_t max_bytes );
+void             solverTraceClear  ( SOLVER_TRACE_S * ptrace );
+void             solverTraceDestroy( SOLVER_TRACE_S * ptrace );
+        /*
+        ** Creates, empties and destroys a trace. The trace grows as events arrive, up to max_bytes,
+        ** after which it stops recording and is marked as truncated.
+        ** solverTraceCreate returns NULL if the memory could not be allocated.
+        */
+
+void solverCtxTrace( SOLVER_CTX_S * pctx, SOLVER_TRACE_S * ptrace );
+        /*
+        ** Records the events of every later search made with the context in ptrace, adding to what
+        ** is already there, until called again with NULL. The trace must outlive its use by the
+        ** context.
+        **
+        ** Only SOLVER_BACKEND_PRUNE records events, and only when it runs on one thread. With a
+        ** trace attached a search runs a few percent slower. Without one, it costs nothing
+        ** measurable, and builds of solver.c with SOLVER_TRACE defined as 0 leave the recorder
+        ** out entirely, so this call does nothing.
+        */
+
+SOLVER_TABLE_S * solverTableCreate ( size_t max_bytes );
+void             solverTableClear  ( SOLVER_TABLE_S * ptable );
+void             solverTableDestroy( SOLVER_TABLE_S * ptable );
+size_t           solverTableBytes  ( const SOLVER_TABLE_S * ptable );
+        /*
+        ** Creates, empties and destroys a transposition table, and returns its size. The table
+        ** takes the largest power of two bytes up to max_bytes, with a minimum of 32, all
+        ** allocated up front. Once a part of the table fills up, new entries replace old ones.
+        ** solverTableClear must not be called while a search is using the table.
+        ** solverTableCreate returns NULL if the memory could not be allocated.
+        */
+
+void solverCtxTable( SOLVER_CTX_S * pctx, SOLVER_TABLE_S * ptable );
+        /*
+        ** Has every later search made with the context by SOLVER_BACKEND_PRUNE use ptable, until
+        ** called again with NULL. The table must outlive its use by the context.
+        **
+        ** A state is identified by a 64 bit hash of every value placed in it, givens included, so
+        ** entries stay true for later boards and one table can be kept across many solves. It is
+        ** lock-free, and several contexts can share it from different threads. The workers of a
+        ** parallel solve share the caller's table. The table_hits, table_misses and table_stores
+        ** statistics show whether it pays for its size. It helps most on 16x16 boards searched
+        ** with restarts, which come back to the same states again and again.
+        */
+
+const unsigned char * solverTraceData     ( const SOLVER_TRACE_S * ptrace, size_t * psize );
+unsigned long long    solverTraceEvents   ( const SOLVER_TRACE_S * ptrace );
+int                   solverTraceTruncated( const SOLVER_TRACE_S * ptrace );
+        /*
+        ** Return the recorded bytes and their size, the number of events recorded, and whether
+        ** any events were left out because the trace was full. The bytes can be saved and read
+        ** back later with solverTraceRead.
+        */
+
+void solverTraceReaderInit( SOLVER_TRACE_READER_S * preader, const unsigned char * data, size_t size );
+int  solverTraceRead      ( SOLVER_TRACE_READER_S * preader, SOLVER_TRACE_EVENT_S * pevent );
+        /*
+        ** Reads the events of a trace in the order they happened. solverTraceRead fills in the
+        ** next event and returns non-zero, or returns zero once there are none left.
+        */
+
+int solverSolveCtx( SOLVER_CTX_S * pctx, const SUDOKU_S * psudoku, SUDOKU_S * solution );
+        /*
+        ** Solves the board in psudoku using the given context, with its search options and no
+        ** limits.
+        ** Only the entries that were blank in psudoku are filled in on the solution.
+        ** Returns SOLVER_SOLVED if a solution was found, SOLVER_NO_SOLUTION if there is none,
+        ** or SOLVER_EXHAUSTED.
+        */
+
+void solverOptsInit( SOLVER_OPTS_S * popts );
+        /*
+        ** Fills in the default options.
+        */
+
+void solverCtxOpts( SOLVER_CTX_S * pctx, const SOLVER_OPTS_S * popts );
+        /*
+        ** Gives the context the search options in popts, or the defaults if popts is NULL, for
+        ** every later search made with it. The backend, threads and limits are left out, since
+        ** they only apply to a single solve. Counts, enumerations and steps have no other way to
+        ** take options.
+        **
+        ** Restarts and learning stop once a search has found a solution, so a count or an
+        ** enumeration never skips or repeats one. Steps never restart.
+        */
+
+int solverSolveEx(
+        SOLVER_CTX_S *        pctx,
+        const SUDOKU_S *      psudoku,
+        SUDOKU_S *            solution,
+        const SOLVER_OPTS_S * popts
+                /*
+                ** Options for this solve. NULL uses the defaults.
+                */
+        );
+        /*
+        ** Same as solverSolveCtx, with options. The search options are kept on the context
+        ** afterwards, as if given to solverCtxOpts.
+        */
+
 int solverSolve( const SUDOKU_S * psudoku, SUDOKU_S * solution );
+        /*
+        ** Same as solverSolveCtx, but uses a single internal context.
+        ** Not safe to call from more than one thread at a time.
+        */
+
+unsigned long long solverCountSolutionsCtx(
+        SOLVER_CTX_S *     pctx,
+        const SUDOKU_S *   psudoku,
+        unsigned long long limit,
+                /*
+                ** Stop counting once this many solutions have been found. Zero counts them all.
+                */
+        SUDOKU_S *         solutions
+                /*
+                ** Array of two boards that receive the first two solutions found, complete with the
+                ** initial values. Can be NULL.
+                */
+        );
+unsigned long long solverCountSolutions( const SUDOKU_S * psudoku, unsigned long long limit, SUDOKU_S * solutions );
+        /*
+        ** Counts the solutions of the board in psudoku, up to limit.
+        ** Returns the number of solutions found. This is a lower bound if the solve is
+        ** exhausted part way through. Only as many entries of solutions are filled in
+        ** as there were solutions found, so a board has exactly one solution when counting with a
+        ** limit of 2 returns 1, and the two entries show the difference when it returns 2.
+        **
+        ** solverCountSolutions uses the same internal context as solverSolve, and has the same
+        ** threading restriction.
+        */
+
+void solverStart( SOLVER_CTX_S * pctx, const SUDOKU_S * psudoku );
+int  solverNext ( SOLVER_CTX_S * pctx, SUDOKU_S * solution );
+        /*
+        ** Iterates over every solution of the board in psudoku.
+        ** solverStart sets up the context for the board, then each call to solverNext fills in
+        ** the next solution, complete with the initial values, and returns SOLVER_SOLVED. Once there
+        ** are no solutions left it returns SOLVER_NO_SOLUTION, or SOLVER_EXHAUSTED if it ran out of
+        ** memory first.
+        **
+        ** The search resumes where the previous call left off and no solutions are kept, so memory
+        ** use is the same however many solutions there are. Stopping early needs no clean up, and the
+        ** context can be used for something else at any time. psudoku is not needed after solverStart.
+        */
+
+int solverStep( SOLVER_CTX_S * pctx, unsigned int budget_us, SUDOKU_S * solution );
+        /*
+        ** Same as solverNext, but gives up the search after about budget_us microseconds and
+        ** returns SOLVER_IN_PROGRESS. The next call to solverStep or solverNext carries on from
+        ** exactly where it stopped. A budget of 0 runs until there is an answer.
+        **
+        ** This solves a board a little at a time on a thread that has other work to do, such
+        ** as one step per frame on the UI thread. The time is checked every few values tried,
+        ** so a step can run over its budget by a few microseconds.
+        */
+
+unsigned long long solverEnumerate(
+        SOLVER_CTX_S *       pctx,
+        const SUDOKU_S *     psudoku,
+        SOLVER_SOLUTION_FN * pfunc,
+        void *               parg
+                /*
+                ** Passed to pfunc with each solution.
+                */
+        );
+        /*
+        ** Calls pfunc with each solution of the board in psudoku, until there are no more or
+        ** pfunc asks to stop. Returns the number of solutions passed to pfunc.
+        */
+
+typedef void SOLVER_PROGRESS_FN( size_t done, size_t total, unsigned long long count, void * parg );
+        /*
+        ** Receives progress from solverCountSolutionsParallel each time a subtree is finished, with
+        ** the number of subtrees done out of the total and the number of solutions found so far.
+        ** Called from the worker threads, but never by two of them at the same time.
+        */
+
+int solverCountSolutionsParallel(
+        const SUDOKU_S *     psudoku,
+        unsigned long long * pcount,
+                /*
+                ** Receives the number of solutions.
+                */
+        int                  threads,
+                /*
+                ** Number of worker threads to use. Zero or less uses one thread per processor.
+                */
+        SOLVER_PROGRESS_FN * pfunc,
+        void *               parg
+                /*
+                ** Progress callback and its argument. pfunc can be NULL.
+                */
+        );
+        /*
+        ** Counts every solution of the board in psudoku, using a pool of worker threads.
+        **
+        ** The search tree is split into a few hundred subtrees, which are counted in parallel and
+        ** added up at the end. The split only depends on the board, so both the count and the
+        ** subtrees reported through pfunc are the same whatever the number of threads.
+        **
+        ** There is no limit, so this is meant for boards whose solutions can all be counted, such
+        ** as an empty 4x4 board or a 9x9 board with a few bands filled in.
+        ** Returns 0, or -1 if the threads or contexts could not be created or a subtree was
+        ** exhausted.
+        */
+
+void solverEditStart( SOLVER_CTX_S * pctx, const SUDOKU_S * psudoku );
+        /*
+        ** Starts editing a copy of the board in psudoku, which can be blank.
+        ** The copy is kept in the context, apart from the state used by solves, so the context can
+        ** still be used to solve boards, including the one being edited, between edits.
+        */
+
+int solverAssign  ( SOLVER_CTX_S * pctx, unsigned int row, unsigned int col, unsigned int val );
+int solverUnassign( SOLVER_CTX_S * pctx, unsigned int row, unsigned int col );
+        /*
+        ** Fills in and clears a cell of the board being edited. Assigning to a filled cell
+        ** replaces its value. Only the cell and its peers are updated, so each edit is cheap
+        ** enough to make on every touch.
+        ** Returns the same as solverEditConsistent after the edit. Out of range arguments leave
+        ** the board unchanged.
+        */
+
+unsigned int solverCandidates( const SOLVER_CTX_S * pctx, unsigned int row, unsigned int col );
+        /*
+        ** Returns the values still possible in an empty cell of the board being edited, as a
+        ** bitmask where bit (value - 1) is set for each possible value. Returns 0 for a filled cell.
+        */
+
+int solverConflicts( const SOLVER_CTX_S * pctx, unsigned int row, unsigned int col );
+        /*
+        ** Returns non-zero if a filled cell of the board being edited holds a value that appears
+        ** again in its row, column or region. Returns 0 for an empty cell.
+        */
+
+int solverEditConsistent( const SOLVER_CTX_S * pctx );
+        /*
+        ** Returns non-zero if no unit of the board being edited holds a value twice, and every
+        ** empty cell has at least one possible value. A consistent board can still be unsolvable.
+        ** Solving solverEditBoard settles that, and counting its solutions checks it is unique.
+        */
+
+const SUDOKU_S * solverEditBoard( const SOLVER_CTX_S * pctx );
+        /*
+        ** Returns the board being edited. Valid until the context is destroyed.
+        */
+
+int solverSolveBatch(
+        const SUDOKU_S *      psudoku,
+        SUDOKU_S *            solution,
+        int *                 status,
+                /*
+                ** Receives the result of each solve. Can be NULL.
+                */
+        SOLVER_STATS_S *      stats,
+                /*
+                ** Receives the statistics of each solve. Can be NULL.
+                */
+        size_t                count,
+        int                   threads,
+                /*
+                ** Number of worker threads to use. Zero or less uses one thread per processor.
+                */
+        const SOLVER_OPTS_S * popts
+                /*
+                ** Options for every board, or NULL for the defaults. The limits apply to each board
+                ** on its own, and the threads field is ignored, since each board is solved on one
+                ** worker. Once pcancel is set, the boards not yet started return SOLVER_CANCELLED
+                ** straight away.
+                */
+        );
+        /*
+        ** Solves count boards from the psudoku array, storing each result at the same index
+        ** in the solution and status arrays.
+        **
+        ** The boards are spread over a pool of worker threads, each with its own solver context.
+        ** Idle workers steal ranges of boards from busy ones, so a few slow boards do not hold up
+        ** the rest of the batch.
+        **
+        ** Returns the number of boards solved, or -1 if the threads or contexts could not be created.
+        */
 
 #endif
@@ -0,0 +1,267 @@
+/*
+** Bitboard solver for 9x9 boards.
+**
+** The general solver works cell by cell. This one is specialized for n = 3 and works value by
+** value instead. For each value it keeps an 81 bit mask of the cells where that value can still
+** go, held in a 128 bit register. Eliminating candidates, finding naked singles and finding hidden
+** singles then become a handful of AND, OR and AND-NOT operations over whole masks, with no loops
+** over individual cells.
+**
+** - Placing a value clears the cell from every value mask, and clears the cell's 20 peers from
+**   the placed value's mask.
+** - Naked singles are the cells that appear in exactly one value mask. These are found by
+**   accumulating the nine masks into 'seen once' and 'seen twice' masks.
+** - Hidden singles are found by intersecting each value mask with each of the 27 unit masks and
+**   checking for a single remaining bit.
+**
+** When neither rule finds anything the search branches on a cell with two candidates, copying
+** the whole state (a few hundred bytes) rather than undoing changes on backtrack.
+**
+** The engine is written once in solver_bb_tpl.h and compiled with plain 64 bit integers, and again
+** with SSE2 or NEON when the compiler targets them. The choice is made at compile time: SSE2 is part
+** of every x86-64 processor and NEON of every ARM target this app is built for, so there is nothing
+** left to ask the processor. The plain version is the fallback for other targets.
+*/
+
+/*
+** PREREQUISITES
+*/
+#include <stdint.h>
+#include <pthread.h>
+
+#if defined(__SSE2__)
+    #define SOLVER_BB_HAVE_SSE2 1
+    #include <emmintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    #define SOLVER_BB_HAVE_NEON 1
+    #include <arm_neon.h>
+#endif
+
+#include "sudoku.h"
+#include "solver.h"
+#include "solver_bb.h"
+#include "solver_bits.h"
+
+
+/*
+** DEFINITIONS
+*/
+
+#define SOLVER_BB_PASTE(a, b) a##b
+#define SOLVER_BB_NAME(a, b)  SOLVER_BB_PASTE(a, b)
+
+struct _SOLVER_BB_MASK_S
+{
+    /*
+    ** An 81 bit cell mask in memory. Bit (row * 9) + col represents a cell.
+    ** Each kernel loads these into its own register type.
+    */
+    uint64_t lo;
+    uint64_t hi;
+} __attribute__((aligned(16)));
+typedef struct _SOLVER_BB_MASK_S SOLVER_BB_MASK_S;
+
+typedef int SOLVER_BB_SOLVE_FN( const SUDOKU_S * psudoku, SUDOKU_S * solution, SOLVER_BB_POLL_FN * ppoll, void * parg );
+
+
+/*
+** LOCAL VARIABLES
+*/
+
+static SOLVER_BB_MASK_S solver_bb_cell [81]; /* The cell on its own */
+static SOLVER_BB_MASK_S solver_bb_peers[81]; /* Cells sharing a row, column or region, excluding the cell */
+static SOLVER_BB_MASK_S solver_bb_unit [27]; /* Rows, then columns, then regions */
+static SOLVER_BB_MASK_S solver_bb_full;      /* All 81 cells */
+
+static pthread_once_t       solver_bb_once = PTHREAD_ONCE_INIT;
+static SOLVER_BB_SOLVE_FN * solver_bb_solve_fn;
+static const char *         solver_bb_kernel;
+        /*
+        ** Tables and kernel selection are set up once, by whichever thread solves first.
+        ** They are read only after that.
+        */
+
+
+/*
+** KERNELS
+*/
+
+#define SOLVER_BB_T              SOLVER_BB_MASK_S
+#define SOLVER_BB_SUFFIX         _scalar
+#define SOLVER_BB_LOAD(pm)       (*(pm))
+#define SOLVER_BB_ZERO()         ((SOLVER_BB_MASK_S){ 0, 0 })
+#define SOLVER_BB_AND(a, b)      ((SOLVER_BB_MASK_S){ (a).lo &  (b).lo, (a).hi &  (b).hi })
+#define SOLVER_BB_OR(a, b)       ((SOLVER_BB_MASK_S){ (a).lo |  (b).lo, (a).hi |  (b).hi })
+#define SOLVER_BB_ANDNOT(a, b)   ((SOLVER_BB_MASK_S){ (a).lo & ~(b).lo, (a).hi & ~(b).hi })
+#define SOLVER_BB_LO(a)          ((a).lo)
+#define SOLVER_BB_HI(a)          ((a).hi)
+#define SOLVER_BB_ISZERO(a)      (((a).lo | (a).hi) == 0)
+#include "solver_bb_tpl.h"
+#undef SOLVER_BB_T
+#undef SOLVER_BB_SUFFIX
+#undef SOLVER_BB_LOAD
+#undef SOLVER_BB_ZERO
+#undef SOLVER_BB_AND
+#undef SOLVER_BB_OR
+#undef SOLVER_BB_ANDNOT
+#undef SOLVER_BB_LO
+#undef SOLVER_BB_HI
+#undef SOLVER_BB_ISZERO
+
+#if defined(SOLVER_BB_HAVE_SSE2)
+
+static inline uint64_t solverBBSse2Lo( __m128i a )
+{
+#if defined(__x86_64__)
+    return (uint64_t)_mm_cvtsi128_si64( a );
+#else
+    uint64_t half[2];
+    _mm_storeu_si128( (__m128i *)half, a );
+    return half[0];
+#endif
+}
+
+static inline uint64_t solverBBSse2Hi( __m128i a )
+{
+#if defined(__x86_64__)
+    return (uint64_t)_mm_cvtsi128_si64( _mm_unpackhi_epi64( a, a ) );
+#else
+    uint64_t half[2];
+    _mm_storeu_si128( (__m128i *)half, a );
+    return half[1];
+#endif
+}
+
+static inline int solverBBSse2IsZero( __m128i a )
+{
+    return _mm_movemask_epi8( _mm_cmpeq_epi8( a, _mm_setzero_si128() ) ) == 0xFFFF;
+}
+
+#define SOLVER_BB_T              __m128i
+#define SOLVER_BB_SUFFIX         _sse2
+#define SOLVER_BB_LOAD(pm)       _mm_load_si128( (const __m128i *)(pm) )
+#define SOLVER_BB_ZERO()         _mm_setzero_si128()
+#define SOLVER_BB_AND(a, b)      _mm_and_si128( (a), (b) )
+#define SOLVER_BB_OR(a, b)       _mm_or_si128( (a), (b) )
+#define SOLVER_BB_ANDNOT(a, b)   _mm_andnot_si128( (b), (a) )
+#define SOLVER_BB_LO(a)          solverBBSse2Lo( a )
+#define SOLVER_BB_HI(a)          solverBBSse2Hi( a )
+#define SOLVER_BB_ISZERO(a)      solverBBSse2IsZero( a )
+#include "solver_bb_tpl.h"
+#undef SOLVER_BB_T
+#undef SOLVER_BB_SUFFIX
+#undef SOLVER_BB_LOAD
+#undef SOLVER_BB_ZERO
+#undef SOLVER_BB_AND
+#undef SOLVER_BB_OR
+#undef SOLVER_BB_ANDNOT
+#undef SOLVER_BB_LO
+#undef SOLVER_BB_HI
+#undef SOLVER_BB_ISZERO
+
+#endif
+
+#if defined(SOLVER_BB_HAVE_NEON)
+
+#define SOLVER_BB_T              uint64x2_t
+#define SOLVER_BB_SUFFIX         _neon
+#define SOLVER_BB_LOAD(pm)       vld1q_u64( (const uint64_t *)(pm) )
+#define SOLVER_BB_ZERO()         vdupq_n_u64( 0 )
+#define SOLVER_BB_AND(a, b)      vandq_u64( (a), (b) )
+#define SOLVER_BB_OR(a, b)       vorrq_u64( (a), (b) )
+#define SOLVER_BB_ANDNOT(a, b)   vbicq_u64( (a), (b) )
+#define SOLVER_BB_LO(a)          vgetq_lane_u64( (a), 0 )
+#define SOLVER_BB_HI(a)          vgetq_lane_u64( (a), 1 )
+#define SOLVER_BB_ISZERO(a)      ((vgetq_lane_u64( (a), 0 ) | vgetq_lane_u64( (a), 1 )) == 0)
+#include "solver_bb_tpl.h"
+#undef SOLVER_BB_T
+#undef SOLVER_BB_SUFFIX
+#undef SOLVER_BB_LOAD
+#undef SOLVER_BB_ZERO
+#undef SOLVER_BB_AND
+#undef SOLVER_BB_OR
+#undef SOLVER_BB_ANDNOT
+#undef SOLVER_BB_LO
+#undef SOLVER_BB_HI
+#undef SOLVER_BB_ISZERO
+
+#endif
+
+
+/*
+** LOCAL FUNCTIONS
+*/
+
+static void solverBBSetBit( SOLVER_BB_MASK_S * pm, int bit )
+{
+    if( bit < 64 )
+        pm->lo |= (uint64_t)1 << bit;
+    else
+        pm->hi |= (uint64_t)1 << (bit - 64);
+}
+
+static void solverBBInit( void )
+{
+    for( int cell=0; cell<81; cell++ )
+    {
+        int row = cell / 9;
+        int col = cell % 9;
+        int reg = ((row / 3) * 3) + (col / 3);
+
+        solverBBSetBit( &solver_bb_cell[cell],     cell );
+        solverBBSetBit( &solver_bb_unit[row],      cell );
+        solverBBSetBit( &solver_bb_unit[9  + col], cell );
+        solverBBSetBit( &solver_bb_unit[18 + reg], cell );
+        solverBBSetBit( &solver_bb_full,           cell );
+    }
+
+    for( int cell=0; cell<81; cell++ )
+    {
+        int row = cell / 9;
+        int col = cell % 9;
+        int reg = ((row / 3) * 3) + (col / 3);
+
+        solver_bb_peers[cell].lo = (solver_bb_unit[row].lo | solver_bb_unit[9 + col].lo | solver_bb_unit[18 + reg].lo) & ~solver_bb_cell[cell].lo;
+        solver_bb_peers[cell].hi = (solver_bb_unit[row].hi | solver_bb_unit[9 + col].hi | solver_bb_unit[18 + reg].hi) & ~solver_bb_cell[cell].hi;
+    }
+
+    /*
+    ** Select the widest kernel compiled in.
+    */
+    solver_bb_solve_fn = solverBBSolve_scalar;
+    solver_bb_kernel   = "scalar";
+
+#if defined(SOLVER_BB_HAVE_SSE2)
+    solver_bb_solve_fn = solverBBSolve_sse2;
+    solver_bb_kernel   = "sse2";
+#endif
+
+#if defined(SOLVER_BB_HAVE_NEON)
+    solver_bb_solve_fn = solverBBSolve_neon;
+    solver_bb_kernel   = "neon";
+#endif
+}
+
+
+/*
+** EXPORTED FUNCTIONS
+*/
+
+int solverBBSolve( const SUDOKU_S * psudoku, SUDOKU_S * solution, SOLVER_BB_POLL_FN * ppoll, void * parg )
+{
+    pthread_once( &solver_bb_once, solverBBInit );
+
+    if( psudoku->n != 3 )
+        return SOLVER_NO_SOLUTION;
+
+    return solver_bb_solve_fn( psudoku, solution, ppoll, parg );
+}
+
+const char * solverBBKernel( void )
+{
+    pthread_once( &solver_bb_once, solverBBInit );
+
+    return solver_bb_kernel;
+}
@@ -0,0 +1,34 @@
+#ifndef __SOLVER_BB_H__
+#define __SOLVER_BB_H__
+/*
+** Bitboard solver for 9x9 boards.
+** Used by solver.c for the SOLVER_BACKEND_BITBOARD backend. For details see the source file.
+*/
+
+#include "sudoku.h"
+
+/*
+** PUBLIC FUNCTIONS
+*/
+
+typedef int SOLVER_BB_POLL_FN( void * parg );
+        /*
+        ** Called with parg before each value the search tries. Returns zero to carry on, or the
+        ** result the solve stops with, such as SOLVER_TIMEOUT.
+        */
+
+int solverBBSolve( const SUDOKU_S * psudoku, SUDOKU_S * solution, SOLVER_BB_POLL_FN * ppoll, void * parg );
+        /*
+        ** Solves a 9x9 board (n = 3).
+        ** Returns SOLVER_SOLVED or SOLVER_NO_SOLUTION, the same as the other backends, or whatever
+        ** ppoll stopped the search with. ppoll can be NULL to search until done.
+        ** Uses no heap memory and no shared mutable state, so it can be called from any thread.
+        */
+
+const char * solverBBKernel( void );
+        /*
+        ** Returns the name of the kernel this build uses, such as "sse2",
+        ** "neon" or "scalar". Intended for diagnostics.
+        */
+
+#endif /* __SOLVER_BB_H__ */
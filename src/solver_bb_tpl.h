@@ -0,0 +1,296 @@
+/*
+** Bitboard solver template.
+**
+** Included by solver_bb.c once for each instruction set. Before including, solver_bb.c defines
+** the mask type SOLVER_BB_T, the operations on it, and SOLVER_BB_SUFFIX which is appended to the
+** name of every function defined here. No include guard on purpose.
+**
+** Operations expected:
+**
+**  SOLVER_BB_LOAD(pm)       Loads a SOLVER_BB_MASK_S into a SOLVER_BB_T.
+**  SOLVER_BB_ZERO()         All bits clear.
+**  SOLVER_BB_AND(a, b)      a & b
+**  SOLVER_BB_OR(a, b)       a | b
+**  SOLVER_BB_ANDNOT(a, b)   a & ~b
+**  SOLVER_BB_LO(a)          Bits 0 to 63 as a 64 bit integer.
+**  SOLVER_BB_HI(a)          Bits 64 to 127 as a 64 bit integer.
+**  SOLVER_BB_ISZERO(a)      Non-zero if no bits are set.
+*/
+
+#define SOLVER_BB_FN(name) SOLVER_BB_NAME(name, SOLVER_BB_SUFFIX)
+
+struct SOLVER_BB_FN(_SOLVER_BB_STATE_S)
+{
+    SOLVER_BB_T cand  [9]; /* Unsolved cells where each value is still possible */
+    SOLVER_BB_T placed[9]; /* Cells holding each value */
+    SOLVER_BB_T solved;    /* Cells holding any value */
+};
+typedef struct SOLVER_BB_FN(_SOLVER_BB_STATE_S) SOLVER_BB_FN(SOLVER_BB_STATE_S);
+
+
+static inline int SOLVER_BB_FN(solverBBIsZero)( SOLVER_BB_T a )
+{
+    return SOLVER_BB_ISZERO(a);
+}
+
+static inline int SOLVER_BB_FN(solverBBFirst)( SOLVER_BB_T a )
+{
+    /*
+    ** Returns the index of the lowest set bit. The mask must not be empty.
+    */
+    uint64_t lo = SOLVER_BB_LO(a);
+
+    if( lo != 0 )
+        return SOLVER_CTZ64( lo );
+    else
+        return 64 + SOLVER_CTZ64( SOLVER_BB_HI(a) );
+}
+
+static inline void SOLVER_BB_FN(solverBBAssign)( SOLVER_BB_FN(SOLVER_BB_STATE_S) * ps, int cell, int val )
+{
+    /*
+    ** Places val in cell. The cell is removed from the candidates of every value, and val
+    ** is removed from the candidates of every peer of the cell.
+    */
+    SOLVER_BB_T bit = SOLVER_BB_LOAD( &solver_bb_cell[cell] );
+
+    for( int v=0; v<9; v++ )
+    {
+        ps->cand[v] = SOLVER_BB_ANDNOT( ps->cand[v], bit );
+    }
+    ps->cand  [val] = SOLVER_BB_ANDNOT( ps->cand[val], SOLVER_BB_LOAD( &solver_bb_peers[cell] ) );
+    ps->placed[val] = SOLVER_BB_OR( ps->placed[val], bit );
+    ps->solved      = SOLVER_BB_OR( ps->solved, bit );
+}
+
+static int SOLVER_BB_FN(solverBBPropagate)( SOLVER_BB_FN(SOLVER_BB_STATE_S) * ps )
+{
+    /*
+    ** Applies naked and hidden singles until neither finds anything more.
+    ** Returns zero if the board can no longer be solved.
+    **
+    ** Cells with exactly one candidate are found for all 81 cells at once, by accumulating the
+    ** value masks into 'seen once' and 'seen twice' masks. Unsolved cells missing from the 'once'
+    ** mask have no candidates left at all.
+    */
+    SOLVER_BB_T full = SOLVER_BB_LOAD( &solver_bb_full );
+
+    for( ;; )
+    {
+        SOLVER_BB_T once  = SOLVER_BB_ZERO();
+        SOLVER_BB_T twice = SOLVER_BB_ZERO();
+
+        for( int v=0; v<9; v++ )
+        {
+            twice = SOLVER_BB_OR( twice, SOLVER_BB_AND( once, ps->cand[v] ) );
+            once  = SOLVER_BB_OR( once, ps->cand[v] );
+        }
+
+        SOLVER_BB_T open = SOLVER_BB_ANDNOT( full, ps->solved );
+
+        if( !SOLVER_BB_FN(solverBBIsZero)( SOLVER_BB_ANDNOT( open, once ) ) )
+            return 0;
+
+        SOLVER_BB_T singles = SOLVER_BB_ANDNOT( once, twice );
+
+        if( !SOLVER_BB_FN(solverBBIsZero)( singles ) )
+        {
+            uint64_t half[2] = { SOLVER_BB_LO(singles), SOLVER_BB_HI(singles) };
+
+            for( int h=0; h<2; h++ )
+            {
+                while( half[h] != 0 )
+                {
+                    int cell = (h * 64) + SOLVER_CTZ64( half[h] );
+                    int val  = 0;
+
+                    half[h] &= half[h] - 1;
+
+                    SOLVER_BB_T bit = SOLVER_BB_LOAD( &solver_bb_cell[cell] );
+
+                    while( val < 9 && SOLVER_BB_FN(solverBBIsZero)( SOLVER_BB_AND( ps->cand[val], bit ) ) )
+                        val++;
+
+                    if( val == 9 )
+                        return 0; /* An earlier single in this pass took its last value */
+
+                    SOLVER_BB_FN(solverBBAssign)( ps, cell, val );
+                }
+            }
+            continue;
+        }
+
+        int progress = 0;
+
+        for( int v=0; v<9; v++ )
+        {
+            for( int u=0; u<27; u++ )
+            {
+                SOLVER_BB_T unit = SOLVER_BB_LOAD( &solver_bb_unit[u] );
+                SOLVER_BB_T m    = SOLVER_BB_AND( ps->cand[v], unit );
+
+                if( SOLVER_BB_FN(solverBBIsZero)( m ) )
+                {
+                    if( SOLVER_BB_FN(solverBBIsZero)( SOLVER_BB_AND( ps->placed[v], unit ) ) )
+                        return 0; /* Nowhere left for the value in this unit */
+                    continue;
+                }
+
+                if( SOLVER_POPCOUNT64( SOLVER_BB_LO(m) ) + SOLVER_POPCOUNT64( SOLVER_BB_HI(m) ) == 1 )
+                {
+                    SOLVER_BB_FN(solverBBAssign)( ps, SOLVER_BB_FN(solverBBFirst)( m ), v );
+                    progress = 1;
+                }
+            }
+        }
+
+        if( !progress )
+            return 1;
+    }
+}
+
+static int SOLVER_BB_FN(solverBBChooseCell)( const SOLVER_BB_FN(SOLVER_BB_STATE_S) * ps )
+{
+    /*
+    ** Picks the cell to branch on. Counting up to three candidates for every cell at once is
+    ** enough to find a cell with exactly two, which is the best choice once singles are gone.
+    ** Returns -1 if every cell is solved.
+    */
+    SOLVER_BB_T once   = SOLVER_BB_ZERO();
+    SOLVER_BB_T twice  = SOLVER_BB_ZERO();
+    SOLVER_BB_T thrice = SOLVER_BB_ZERO();
+
+    for( int v=0; v<9; v++ )
+    {
+        thrice = SOLVER_BB_OR( thrice, SOLVER_BB_AND( twice, ps->cand[v] ) );
+        twice  = SOLVER_BB_OR( twice,  SOLVER_BB_AND( once,  ps->cand[v] ) );
+        once   = SOLVER_BB_OR( once, ps->cand[v] );
+    }
+
+    SOLVER_BB_T pairs = SOLVER_BB_ANDNOT( twice, thrice );
+
+    if( !SOLVER_BB_FN(solverBBIsZero)( pairs ) )
+        return SOLVER_BB_FN(solverBBFirst)( pairs );
+
+    if( !SOLVER_BB_FN(solverBBIsZero)( once ) )
+        return SOLVER_BB_FN(solverBBFirst)( once );
+
+    return -1;
+}
+
+static int SOLVER_BB_FN(solverBBSolve)(
+    const SUDOKU_S *    psudoku,
+    SUDOKU_S *          solution,
+    SOLVER_BB_POLL_FN * ppoll,
+    void *              parg
+    ) {
+    /*
+    ** Depth first search, copying the state at each branch. The state is small enough that
+    ** copying it is cheaper than recording and undoing changes.
+    */
+    SOLVER_BB_FN(SOLVER_BB_STATE_S) stack[ 82 ];
+
+    int           cell_a[ 82 ];
+    unsigned int  vals_a[ 82 ];
+    int           depth = 0;
+
+    SOLVER_BB_FN(SOLVER_BB_STATE_S) * ps = &stack[0];
+
+    SOLVER_BB_T full = SOLVER_BB_LOAD( &solver_bb_full );
+
+    for( int v=0; v<9; v++ )
+    {
+        ps->cand  [v] = full;
+        ps->placed[v] = SOLVER_BB_ZERO();
+    }
+    ps->solved = SOLVER_BB_ZERO();
+
+    for( int cell=0; cell<81; cell++ )
+    {
+        unsigned int bv = psudoku->board[cell / 9][cell % 9];
+
+        if( bv == 0 )
+            continue;
+
+        if( bv > 9 || SOLVER_BB_FN(solverBBIsZero)( SOLVER_BB_AND( ps->cand[bv-1], SOLVER_BB_LOAD( &solver_bb_cell[cell] ) ) ) )
+            return SOLVER_NO_SOLUTION;
+
+        SOLVER_BB_FN(solverBBAssign)( ps, cell, bv-1 );
+    }
+
+    if( !SOLVER_BB_FN(solverBBPropagate)( ps ) )
+        return SOLVER_NO_SOLUTION;
+
+    for( ;; )
+    {
+        int cell = SOLVER_BB_FN(solverBBChooseCell)( &stack[depth] );
+
+        if( cell < 0 )
+            break;
+
+        SOLVER_BB_T  bit  = SOLVER_BB_LOAD( &solver_bb_cell[cell] );
+        unsigned int vals = 0;
+
+        for( int v=0; v<9; v++ )
+        {
+            if( !SOLVER_BB_FN(solverBBIsZero)( SOLVER_BB_AND( stack[depth].cand[v], bit ) ) )
+                vals |= 1 << v;
+        }
+        cell_a[depth] = cell;
+        vals_a[depth] = vals;
+
+        for( ;; )
+        {
+            /*
+            ** Try the next value at this depth, backing up a level whenever one runs out.
+            */
+            if( vals_a[depth] == 0 )
+            {
+                if( depth == 0 )
+                    return SOLVER_NO_SOLUTION;
+                depth--;
+                continue;
+            }
+
+            if( ppoll != NULL )
+            {
+                int stop = ppoll( parg );
+
+                if( stop != 0 )
+                    return stop;
+            }
+
+            int val = SOLVER_CTZ32( vals_a[depth] );
+            vals_a[depth] &= vals_a[depth] - 1;
+
+            stack[depth+1] = stack[depth];
+            SOLVER_BB_FN(solverBBAssign)( &stack[depth+1], cell_a[depth], val );
+
+            if( SOLVER_BB_FN(solverBBPropagate)( &stack[depth+1] ) )
+            {
+                depth++;
+                break;
+            }
+        }
+    }
+
+    for( int v=0; v<9; v++ )
+    {
+        uint64_t half[2] = { SOLVER_BB_LO(stack[depth].placed[v]), SOLVER_BB_HI(stack[depth].placed[v]) };
+
+        for( int h=0; h<2; h++ )
+        {
+            while( half[h] != 0 )
+            {
+                int cell = (h * 64) + SOLVER_CTZ64( half[h] );
+                half[h] &= half[h] - 1;
+
+                if( psudoku->board[cell / 9][cell % 9] == 0 )
+                    solution->board[cell / 9][cell % 9] = v + 1;
+            }
+        }
+    }
+    return SOLVER_SOLVED;
+}
+
+#undef SOLVER_BB_FN
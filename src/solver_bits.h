@@ -0,0 +1,53 @@
+#ifndef __SOLVER_BITS_H__
+#define __SOLVER_BITS_H__
+/*
+** Bit scanning and counting, shared by solver.c and solver_bb.c.
+**
+** GCC and Clang use their builtins, which compile to single instructions where the processor
+** has them. Other compilers get portable versions, free of loops like the builtins. The lowest
+** set bit is looked up by multiplying it with a de Bruijn sequence, and bits are counted in
+** parallel. x must not be zero for the ctz versions.
+*/
+
+#include <stdint.h>
+
+#if defined(__GNUC__) || defined(__clang__)
+    #define SOLVER_CTZ32(x) __builtin_ctz(x)
+    #define SOLVER_CTZ64(x) __builtin_ctzll(x)
+    #define SOLVER_POPCOUNT32(x) __builtin_popcount(x)
+    #define SOLVER_POPCOUNT64(x) __builtin_popcountll(x)
+#else
+    static inline int solverCtz32( uint32_t x )
+    {
+        static const unsigned char index[32] =
+        {
+            0, 1, 28, 2, 29, 14, 24, 3, 30, 22, 20, 15, 25, 17, 4, 8,
+            31, 27, 13, 23, 21, 19, 16, 7, 26, 12, 18, 6, 11, 5, 10, 9
+        };
+        return index[(uint32_t)((x & (0u - x)) * 0x077CB531u) >> 27];
+    }
+    static inline int solverCtz64( uint64_t x )
+    {
+        return ((uint32_t)x != 0) ? solverCtz32( (uint32_t)x ) : 32 + solverCtz32( (uint32_t)(x >> 32) );
+    }
+    static inline int solverPopcount32( uint32_t x )
+    {
+        x = x - ((x >> 1) & 0x55555555u);
+        x = (x & 0x33333333u) + ((x >> 2) & 0x33333333u);
+        x = (x + (x >> 4)) & 0x0F0F0F0Fu;
+        return (int)((x * 0x01010101u) >> 24);
+    }
+    static inline int solverPopcount64( uint64_t x )
+    {
+        x = x - ((x >> 1) & 0x5555555555555555ull);
+        x = (x & 0x3333333333333333ull) + ((x >> 2) & 0x3333333333333333ull);
+        x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+        return (int)((x * 0x0101010101010101ull) >> 56);
+    }
+    #define SOLVER_CTZ32(x) solverCtz32(x)
+    #define SOLVER_CTZ64(x) solverCtz64(x)
+    #define SOLVER_POPCOUNT32(x) solverPopcount32(x)
+    #define SOLVER_POPCOUNT64(x) solverPopcount64(x)
+#endif
+
+#endif /* __SOLVER_BITS_H__ */
@@ -0,0 +1,1268 @@
+/*
+** Search engine template.
+**
+** Included by solver.c once for each supported box size. Before including, solver.c defines
+** SOLVER_TPL_N, the box size, and SOLVER_TPL_SUFFIX which is appended to the name of every function
+** and table defined here. No include guard on purpose.
+**
+** With the box size fixed at compile time, the number of cells in a unit, the number of peers of
+** a cell, the unit numbers and the value masks are all constants. Every loop in the engine then has
+** a constant bound, which the compiler can unroll, and there are no divisions left in it at all.
+*/
+
+#define SOLVER_TPL_FN(name) SOLVER_NAME(name, SOLVER_TPL_SUFFIX)
+
+#define SOLVER_TPL_NN    (SOLVER_TPL_N * SOLVER_TPL_N)
+#define SOLVER_TPL_CELLS (SOLVER_TPL_NN * SOLVER_TPL_NN)
+#define SOLVER_TPL_UNITS (3 * SOLVER_TPL_NN)
+#define SOLVER_TPL_PEERS ((2 * (SOLVER_TPL_NN - 1)) + ((SOLVER_TPL_N - 1) * (SOLVER_TPL_N - 1)))
+#define SOLVER_TPL_FULL  ((1u << SOLVER_TPL_NN) - 1)
+
+static unsigned char SOLVER_TPL_FN(solver_peers)[ SOLVER_TPL_CELLS ][ SOLVER_TPL_PEERS + 1 ];
+        /*
+        ** The cells sharing a row, column or region with each cell, not counting the cell itself.
+        ** One entry larger than needed, so the array is not empty when n = 1.
+        */
+static uint64_t SOLVER_TPL_FN(solver_unit_bits)[ SOLVER_TPL_CELLS ];
+        /*
+        ** The units of each cell as a unit_dirty mask.
+        */
+
+
+static void SOLVER_TPL_FN(solverTplInit)( void )
+{
+    /*
+    ** Builds the tables. Called once, before any board of this size is solved.
+    */
+    unsigned int unit_size[ SOLVER_TPL_UNITS ] = { 0 };
+
+    for( unsigned int cell=0; cell<SOLVER_TPL_CELLS; cell++ )
+    {
+        unsigned int row = cell / SOLVER_TPL_NN;
+        unsigned int col = cell % SOLVER_TPL_NN;
+        unsigned int reg = ((row / SOLVER_TPL_N) * SOLVER_TPL_N) + (col / SOLVER_TPL_N);
+
+        solver_units[SOLVER_TPL_N][cell][0] = row;
+        solver_units[SOLVER_TPL_N][cell][1] = SOLVER_TPL_NN + col;
+        solver_units[SOLVER_TPL_N][cell][2] = (2 * SOLVER_TPL_NN) + reg;
+
+        SOLVER_TPL_FN(solver_unit_bits)[cell] = 0;
+
+        for( int u=0; u<3; u++ )
+        {
+            unsigned int unit = solver_units[SOLVER_TPL_N][cell][u];
+
+            solver_unit_slot[SOLVER_TPL_N][cell][u] = 1u << unit_size[unit];
+            solver_unit_cells[SOLVER_TPL_N][unit][unit_size[unit]++] = cell;
+            SOLVER_TPL_FN(solver_unit_bits)[cell] |= (uint64_t)1 << unit;
+        }
+    }
+
+    for( unsigned int cell=0; cell<SOLVER_TPL_CELLS; cell++ )
+    {
+        unsigned int count = 0;
+
+        for( unsigned int peer=0; peer<SOLVER_TPL_CELLS; peer++ )
+        {
+            if( peer != cell && (SOLVER_TPL_FN(solver_unit_bits)[cell] & SOLVER_TPL_FN(solver_unit_bits)[peer]) )
+                SOLVER_TPL_FN(solver_peers)[cell][count++] = peer;
+        }
+    }
+}
+
+static inline void SOLVER_TPL_FN(solverWhereClear)( SOLVER_CTX_S * pctx, unsigned int cell, unsigned int mask )
+{
+    /*
+    ** Takes cell out of the places left for each value in mask, in all three of its units.
+    */
+    const unsigned char *  punit = solver_units[SOLVER_TPL_N][cell];
+    const unsigned short * pslot = solver_unit_slot[SOLVER_TPL_N][cell];
+
+    for( ; mask!=0; mask&=mask-1 )
+    {
+        unsigned int vi = SOLVER_CTZ32( mask );
+
+        pctx->unit_where[punit[0]][vi] &= ~pslot[0];
+        pctx->unit_where[punit[1]][vi] &= ~pslot[1];
+        pctx->unit_where[punit[2]][vi] &= ~pslot[2];
+    }
+}
+
+static inline void SOLVER_TPL_FN(solverWhereSet)( SOLVER_CTX_S * pctx, unsigned int cell, unsigned int mask )
+{
+    /*
+    ** Puts cell back among the places left for each value in mask, undoing solverWhereClear.
+    */
+    const unsigned char *  punit = solver_units[SOLVER_TPL_N][cell];
+    const unsigned short * pslot = solver_unit_slot[SOLVER_TPL_N][cell];
+
+    for( ; mask!=0; mask&=mask-1 )
+    {
+        unsigned int vi = SOLVER_CTZ32( mask );
+
+        pctx->unit_where[punit[0]][vi] |= pslot[0];
+        pctx->unit_where[punit[1]][vi] |= pslot[1];
+        pctx->unit_where[punit[2]][vi] |= pslot[2];
+    }
+}
+
+static int SOLVER_TPL_FN(solverEliminate)( SOLVER_CTX_S * pctx, unsigned int cell, unsigned int mask, unsigned int cause )
+{
+    /*
+    ** Removes the values in mask from an open cell, storing each on the backtrack stack like the
+    ** prunes made by solverAssign, with cause as their SOLVER_CAUSE. Returns zero if the cell
+    ** loses its last value, or if the backtracking stack is exhausted.
+    */
+    SOLVER_CANDITATE_S * pc = &pctx->candidate_array[cell];
+
+    mask &= pc->val;
+
+    if( pc->set != 0 || mask == 0 )
+        return 1;
+
+    while( mask != 0 )
+    {
+        unsigned int value = mask & -mask;
+
+        mask &= mask - 1;
+
+        if( !solverTrailPush( pctx, cell, value ) )
+            return 0;
+
+        solverBucketRemove( pctx, cell );
+        pc->val &= ~value;
+        pc->num--;
+        solverBucketInsert( pctx, cell );
+        SOLVER_TPL_FN(solverWhereClear)( pctx, cell, value );
+
+        pctx->prune_cause[cell][SOLVER_CTZ32( value )] = cause;
+
+        SOLVER_STAT_ADD( pctx, prunes, 1 );
+        SOLVER_TRACE_EVENT( pctx, SOLVER_TRACE_PRUNE, cell, value );
+    }
+
+    if( pc->num == 0 )
+    {
+        solverConflict( pctx, SOLVER_CONFLICT_CELL, cell, 0 );
+        return 0;
+    }
+
+    if( pc->num == 1 )
+        solverEnqueue( pctx, cell );
+
+    pctx->unit_dirty |= SOLVER_TPL_FN(solver_unit_bits)[cell];
+    return 1;
+}
+
+static int SOLVER_TPL_FN(solverNogoodWatch)( SOLVER_CTX_S * pctx, unsigned int lit )
+{
+    /*
+    ** Visits the nogoods watching a literal that has just been placed. Each moves its watch to
+    ** another literal that is not placed, if it has one. Otherwise every literal but the other
+    ** watched one is placed, so that one is pruned, or if it is placed too the nogood is broken.
+    ** Returns zero on a conflict.
+    */
+    SOLVER_LEARN_S * pl    = pctx->plearn;
+    unsigned int *   plink = &pl->watch_head[lit];
+
+    while( *plink != SOLVER_NOGOOD_NONE )
+    {
+        unsigned int      g   = *plink;
+        SOLVER_NOGOOD_S * png = &pl->nogood[g];
+        unsigned int      w   = (png->lit[0] == lit) ? 0 : 1;
+        unsigned int      k   = 2;
+
+        while( k < png->count &&
+               pctx->candidate_array[png->lit[k] >> 4].set == (1u << (png->lit[k] & 15)) )
+        {
+            k++;
+        }
+
+        if( k < png->count )
+        {
+            unsigned int next = png->watch_next[w];
+
+            png->lit[w] = png->lit[k];
+            png->lit[k] = lit;
+
+            png->watch_next[w] = pl->watch_head[png->lit[w]];
+            pl->watch_head[png->lit[w]] = g;
+
+            *plink = next;
+            continue;
+        }
+
+        unsigned int         other = png->lit[1-w];
+        unsigned int         value = 1u << (other & 15);
+        SOLVER_CANDITATE_S * pc    = &pctx->candidate_array[other >> 4];
+
+        if( pc->set == value )
+        {
+            solverNogoodTouch( pl, g );
+            solverConflict( pctx, SOLVER_CONFLICT_NOGOOD, 0, g );
+            return 0;
+        }
+
+        if( pc->set == 0 && (pc->val & value) )
+        {
+            solverNogoodTouch( pl, g );
+
+            if( !SOLVER_TPL_FN(solverEliminate)( pctx, other >> 4, value, SOLVER_CAUSE_NOGOOD | g ) )
+                return 0;
+        }
+        plink = &png->watch_next[w];
+    }
+    return 1;
+}
+
+static inline int SOLVER_TPL_FN(solverAssign)( SOLVER_CTX_S * pctx, unsigned int cell, unsigned int value, unsigned int reason )
+{
+    /*
+    ** Places a value in a cell and 'prunes' it from every open peer. Every change is stored on
+    ** the backtrack stack, and the reason, a SOLVER_REASON or a unit, is kept for learning.
+    **
+    ** Cells pruned down to one value are queued for propagation. Returns zero if a cell loses its
+    ** last value, or if the backtracking stack is exhausted, in which case the caller undoes back
+    ** to its own mark.
+    */
+    SOLVER_CANDITATE_S *  pc    = &pctx->candidate_array[cell];
+    const unsigned char * punit = solver_units[SOLVER_TPL_N][cell];
+    unsigned int          vi    = SOLVER_CTZ32( value );
+
+    pctx->assign_level [cell] = pctx->decision_stack_top;
+    pctx->assign_pos   [cell] = pctx->backtrack_stack_top;
+    pctx->assign_reason[cell] = reason;
+
+    if( !solverTrailPush( pctx, cell | SOLVER_BACKTRACK_ASSIGN, value ) )
+        return 0;
+
+    SOLVER_STAT_ADD( pctx, assignments, 1 );
+
+    pc->set     = value;
+    pctx->hash ^= solver_zobrist[cell][vi];
+    solverBucketRemove( pctx, cell );
+    SOLVER_TPL_FN(solverWhereClear)( pctx, cell, pc->val );
+
+    pctx->unit_used[punit[0]] |= value;
+    pctx->unit_used[punit[1]] |= value;
+    pctx->unit_used[punit[2]] |= value;
+    pctx->unit_dirty          |= SOLVER_TPL_FN(solver_unit_bits)[cell];
+
+#if SOLVER_TPL_PEERS > 0 /* A 1x1 board has no peers */
+    for( unsigned int i=0; i<SOLVER_TPL_PEERS; i++ )
+    {
+        unsigned int         peer = SOLVER_TPL_FN(solver_peers)[cell][i];
+        SOLVER_CANDITATE_S * pp   = &pctx->candidate_array[peer];
+
+        if( pp->set == 0 && (pp->val & value) )
+        {
+            if( !solverTrailPush( pctx, peer, value ) ) /* Add the prune operation to the backtrack stack */
+                return 0;
+
+            solverBucketRemove( pctx, peer );
+            pp->val &= ~value;
+            pp->num--; /* Remove the value from the list of candidate values */
+            solverBucketInsert( pctx, peer );
+            SOLVER_TPL_FN(solverWhereClear)( pctx, peer, value );
+
+            pctx->prune_cause[peer][vi] = cell;
+
+            SOLVER_STAT_ADD( pctx, prunes, 1 );
+            SOLVER_TRACE_EVENT( pctx, SOLVER_TRACE_PRUNE, peer, value );
+
+            if( pp->num == 0 )
+            {
+                solverConflict( pctx, SOLVER_CONFLICT_CELL, peer, 0 );
+                return 0;
+            }
+
+            if( pp->num == 1 )
+                solverEnqueue( pctx, peer );
+
+            pctx->unit_dirty |= SOLVER_TPL_FN(solver_unit_bits)[peer];
+        }
+    }
+#endif
+
+    if( pctx->learning )
+        return SOLVER_TPL_FN(solverNogoodWatch)( pctx, SOLVER_LIT( cell, vi ) );
+
+    return 1;
+}
+
+static void SOLVER_TPL_FN(solverUndo)( SOLVER_CTX_S * pctx, unsigned int mark )
+{
+    /*
+    ** Undoes every change above mark on the backtrack stack, restoring pruned values and
+    ** removing placed ones. Any propagation work left over from a failed attempt is dropped.
+    */
+    while( pctx->backtrack_stack_top > mark )
+    {
+        SOLVER_BACKTRACK_S bt = solverTrailPop( pctx );
+
+        if( bt.row & SOLVER_BACKTRACK_ASSIGN )
+        {
+            unsigned int          cell  = bt.row & ~SOLVER_BACKTRACK_ASSIGN;
+            const unsigned char * punit = solver_units[SOLVER_TPL_N][cell];
+
+            pctx->candidate_array[cell].set = 0;
+            pctx->hash ^= solver_zobrist[cell][SOLVER_CTZ32( bt.val )];
+            pctx->unit_used[punit[0]] &= ~bt.val;
+            pctx->unit_used[punit[1]] &= ~bt.val;
+            pctx->unit_used[punit[2]] &= ~bt.val;
+
+            solverBucketInsert( pctx, cell );
+            SOLVER_TPL_FN(solverWhereSet)( pctx, cell, pctx->candidate_array[cell].val );
+        }
+        else
+        {
+            solverBucketRemove( pctx, bt.row );
+            pctx->candidate_array[bt.row].val |= bt.val;
+            pctx->candidate_array[bt.row].num++; /* Restores the candidate value */
+            solverBucketInsert( pctx, bt.row );
+            SOLVER_TPL_FN(solverWhereSet)( pctx, bt.row, bt.val );
+        }
+    }
+    solverQueueClear( pctx );
+}
+
+static int SOLVER_TPL_FN(solverLocked)( SOLVER_CTX_S * pctx )
+{
+    /*
+    ** Locked candidates. Each row is split into the segments it shares with each region, and
+    ** the values still open in each segment are gathered into one mask.
+    **
+    ** - Pointing: values of a region found only in one of its row segments belong to that row,
+    **   so they are removed from the rest of the row.
+    ** - Claiming: values of a row found only in one of its segments belong to that region, so
+    **   they are removed from the rest of the region.
+    **
+    ** The same is then done for columns. Returns zero if the board can no longer be solved.
+    */
+    unsigned int seg[ 2 ][ SOLVER_TPL_NN ][ SOLVER_TPL_N ] = { { { 0 } } };
+    unsigned int cause = SOLVER_CAUSE_LEVEL | pctx->decision_stack_top;
+
+    for( unsigned int cell=0; cell<SOLVER_TPL_CELLS; cell++ )
+    {
+        const SOLVER_CANDITATE_S * pc = &pctx->candidate_array[cell];
+
+        if( pc->set == 0 )
+        {
+            seg[0][cell / SOLVER_TPL_NN][(cell % SOLVER_TPL_NN) / SOLVER_TPL_N] |= pc->val;
+            seg[1][cell % SOLVER_TPL_NN][(cell / SOLVER_TPL_NN) / SOLVER_TPL_N] |= pc->val;
+        }
+    }
+
+    for( unsigned int dir=0; dir<2; dir++ )
+    {
+        for( unsigned int line=0; line<SOLVER_TPL_NN; line++ )
+        {
+            unsigned int band = line - (line % SOLVER_TPL_N);
+
+            for( unsigned int b=0; b<SOLVER_TPL_N; b++ )
+            {
+                unsigned int in_line   = 0;
+                unsigned int in_region = 0;
+
+                for( unsigned int i=0; i<SOLVER_TPL_N; i++ )
+                {
+                    if( i != b )
+                        in_line |= seg[dir][line][i];
+                    if( band + i != line )
+                        in_region |= seg[dir][band + i][b];
+                }
+
+                unsigned int pointing = seg[dir][line][b] & ~in_region;
+                unsigned int claiming = seg[dir][line][b] & ~in_line;
+
+                if( (pointing & in_line) == 0 && (claiming & in_region) == 0 )
+                    continue;
+
+                for( unsigned int i=0; i<SOLVER_TPL_NN; i++ )
+                {
+                    /*
+                    ** i walks along the line for pointing, and through the region for claiming.
+                    */
+                    unsigned int along  = (dir == 0) ? (line * SOLVER_TPL_NN) + i : (i * SOLVER_TPL_NN) + line;
+                    unsigned int across = band + (i / SOLVER_TPL_N);
+                    unsigned int inside = (b * SOLVER_TPL_N) + (i % SOLVER_TPL_N);
+                    unsigned int region = (dir == 0) ? (across * SOLVER_TPL_NN) + inside : (inside * SOLVER_TPL_NN) + across;
+
+                    if( (pointing & in_line) && i / SOLVER_TPL_N != b &&
+                        !SOLVER_TPL_FN(solverEliminate)( pctx, along, pointing, cause ) )
+                    {
+                        return 0;
+                    }
+
+                    if( (claiming & in_region) && across != line &&
+                        !SOLVER_TPL_FN(solverEliminate)( pctx, region, claiming, cause ) )
+                    {
+                        return 0;
+                    }
+                }
+            }
+        }
+    }
+    return 1;
+}
+
+static int SOLVER_TPL_FN(solverSubsets)( SOLVER_CTX_S * pctx )
+{
+    /*
+    ** Naked and hidden pairs and triples, unit by unit.
+    **
+    ** - Naked: k open cells whose values together number k hold exactly those values, so the
+    **   values are removed from the other cells of the unit.
+    ** - Hidden: k values whose positions together number k fill exactly those cells, so every
+    **   other value is removed from the cells.
+    **
+    ** Hidden subsets work on the same masks turned around, with a bit for each position in the
+    ** unit where a value is still open. Returns zero if the board can no longer be solved.
+    */
+    unsigned int cause = SOLVER_CAUSE_LEVEL | pctx->decision_stack_top;
+
+    for( unsigned int unit=0; unit<SOLVER_TPL_UNITS; unit++ )
+    {
+        const unsigned char * pcells = solver_unit_cells[SOLVER_TPL_N][unit];
+
+        unsigned int vals[ SOLVER_TPL_NN ];
+        unsigned int pos [ SOLVER_TPL_NN ] = { 0 };
+        unsigned int open = 0;
+
+        for( unsigned int i=0; i<SOLVER_TPL_NN; i++ )
+        {
+            const SOLVER_CANDITATE_S * pc = &pctx->candidate_array[pcells[i]];
+
+            vals[i] = (pc->set == 0) ? pc->val : 0;
+
+            for( unsigned int m=vals[i]; m!=0; m&=m-1 )
+                pos[SOLVER_CTZ32( m )] |= 1u << i;
+
+            open += (pc->set == 0);
+        }
+
+        if( open <= 2 )
+            continue; /* Any subset is the whole unit, which tells nothing */
+
+        for( unsigned int i=0; i<SOLVER_TPL_NN; i++ )
+        {
+            unsigned int ni = SOLVER_POPCOUNT32( vals[i] );
+            unsigned int hi = SOLVER_POPCOUNT32( pos [i] );
+
+            for( unsigned int j=i+1; j<SOLVER_TPL_NN; j++ )
+            {
+                unsigned int naked  = (ni >= 2 && ni <= 3) ? vals[i] | vals[j] : 0;
+                unsigned int hidden = (hi >= 2 && hi <= 3) ? pos [i] | pos [j] : 0;
+                unsigned int nn     = SOLVER_POPCOUNT32( naked );
+                unsigned int hn     = SOLVER_POPCOUNT32( hidden );
+
+                if( vals[j] == 0 || nn > 3 )
+                    naked = 0;
+                if( pos[j] == 0 || hn > 3 )
+                    hidden = 0;
+
+                if( naked == 0 && hidden == 0 )
+                    continue;
+
+                for( unsigned int k=j+1; k<=SOLVER_TPL_NN; k++ )
+                {
+                    /*
+                    ** k == SOLVER_TPL_NN stands for the pair of i and j on its own.
+                    */
+                    unsigned int naked3  = naked;
+                    unsigned int hidden3 = hidden;
+                    unsigned int cells   = (1u << i) | (1u << j);
+                    unsigned int values  = (1u << i) | (1u << j);
+
+                    if( k < SOLVER_TPL_NN )
+                    {
+                        naked3  = (naked  && vals[k] && SOLVER_POPCOUNT32( vals[k] ) <= 3) ? naked  | vals[k] : 0;
+                        hidden3 = (hidden && pos [k] && SOLVER_POPCOUNT32( pos [k] ) <= 3) ? hidden | pos [k] : 0;
+                        cells  |= 1u << k;
+                        values |= 1u << k;
+
+                        if( SOLVER_POPCOUNT32( naked3 ) != 3 || open <= 3 )
+                            naked3 = 0;
+                        if( SOLVER_POPCOUNT32( hidden3 ) != 3 || open <= 3 )
+                            hidden3 = 0;
+                    }
+                    else
+                    {
+                        if( nn != 2 )
+                            naked3 = 0;
+                        if( hn != 2 )
+                            hidden3 = 0;
+                    }
+
+                    if( naked3 != 0 )
+                    {
+                        for( unsigned int c=0; c<SOLVER_TPL_NN; c++ )
+                        {
+                            if( (cells & (1u << c)) == 0 && (vals[c] & naked3) &&
+                                !SOLVER_TPL_FN(solverEliminate)( pctx, pcells[c], naked3, cause ) )
+                            {
+                                return 0;
+                            }
+                        }
+                    }
+
+                    if( hidden3 != 0 )
+                    {
+                        for( unsigned int m=hidden3; m!=0; m&=m-1 )
+                        {
+                            unsigned int c = SOLVER_CTZ32( m );
+
+                            if( (vals[c] & ~values) &&
+                                !SOLVER_TPL_FN(solverEliminate)( pctx, pcells[c], vals[c] & ~values, cause ) )
+                            {
+                                return 0;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return 1;
+}
+
+static int SOLVER_TPL_FN(solverXWing)( SOLVER_CTX_S * pctx )
+{
+    /*
+    ** X-wing. When a value is open in exactly the same two columns of two rows, it has to take
+    ** one of those columns in each row, so it is removed from the rest of both columns. The
+    ** same is done with rows and columns swapped. Returns zero if the board can no longer be
+    ** solved.
+    */
+    unsigned int cause = SOLVER_CAUSE_LEVEL | pctx->decision_stack_top;
+
+    for( unsigned int value=1; value<=SOLVER_TPL_FULL; value<<=1 )
+    {
+        unsigned int lines[ 2 ][ SOLVER_TPL_NN ] = { { 0 } };
+
+        for( unsigned int cell=0; cell<SOLVER_TPL_CELLS; cell++ )
+        {
+            const SOLVER_CANDITATE_S * pc = &pctx->candidate_array[cell];
+
+            if( pc->set == 0 && (pc->val & value) )
+            {
+                lines[0][cell / SOLVER_TPL_NN] |= 1u << (cell % SOLVER_TPL_NN);
+                lines[1][cell % SOLVER_TPL_NN] |= 1u << (cell / SOLVER_TPL_NN);
+            }
+        }
+
+        for( unsigned int dir=0; dir<2; dir++ )
+        {
+            for( unsigned int a=0; a<SOLVER_TPL_NN; a++ )
+            {
+                if( SOLVER_POPCOUNT32( lines[dir][a] ) != 2 )
+                    continue;
+
+                for( unsigned int b=a+1; b<SOLVER_TPL_NN; b++ )
+                {
+                    if( lines[dir][b] != lines[dir][a] )
+                        continue;
+
+                    for( unsigned int m=lines[dir][a]; m!=0; m&=m-1 )
+                    {
+                        unsigned int cross = SOLVER_CTZ32( m );
+
+                        for( unsigned int other=0; other<SOLVER_TPL_NN; other++ )
+                        {
+                            unsigned int cell = (dir == 0) ? (other * SOLVER_TPL_NN) + cross : (cross * SOLVER_TPL_NN) + other;
+
+                            if( other != a && other != b && (lines[1-dir][cross] & (1u << other)) &&
+                                !SOLVER_TPL_FN(solverEliminate)( pctx, cell, value, cause ) )
+                            {
+                                return 0;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return 1;
+}
+
+static int SOLVER_TPL_FN(solverTiers)( SOLVER_CTX_S * pctx )
+{
+    /*
+    ** Runs the propagation tiers above singles that pctx->level allows, cheapest first, and
+    ** stops at the first that removes anything so singles can pick up from there. Returns
+    ** zero if the board can no longer be solved.
+    */
+    unsigned int mark = pctx->backtrack_stack_top;
+
+    if( !SOLVER_TPL_FN(solverLocked)( pctx ) )
+        return 0;
+    if( pctx->backtrack_stack_top != mark || pctx->level < SOLVER_LEVEL_SUBSETS )
+        return 1;
+
+    if( !SOLVER_TPL_FN(solverSubsets)( pctx ) )
+        return 0;
+    if( pctx->backtrack_stack_top != mark || pctx->level < SOLVER_LEVEL_FISH )
+        return 1;
+
+    return SOLVER_TPL_FN(solverXWing)( pctx );
+}
+
+static int SOLVER_TPL_FN(solverPropagate)( SOLVER_CTX_S * pctx )
+{
+    /*
+    ** Places values that are forced, until nothing more can be deduced.
+    **
+    ** - A naked single is a cell with only one value left. These are queued as they are found
+    **   by solverAssign.
+    ** - A hidden single is a value that has only one cell left in some unit. Units are only
+    **   checked after something in them has changed.
+    **
+    ** The queue is emptied before each unit is checked, since naked singles are cheaper to find.
+    ** Returns zero if the board can no longer be solved, either because a cell has no values left
+    ** or because a unit has nowhere left to put one of its values.
+    */
+    for( ;; )
+    {
+        while( pctx->queue_head < pctx->queue_tail )
+        {
+            unsigned int         cell = pctx->queue[pctx->queue_head++];
+            SOLVER_CANDITATE_S * pc   = &pctx->candidate_array[cell];
+
+            pctx->queued[cell] = 0;
+
+            if( pc->set != 0 )
+                continue; /* Placed as a hidden single since it was queued */
+
+            if( pc->num == 0 )
+            {
+                solverConflict( pctx, SOLVER_CONFLICT_CELL, cell, 0 );
+                return 0;
+            }
+
+            SOLVER_TRACE_EVENT( pctx, SOLVER_TRACE_ASSIGN, cell, pc->val );
+
+            if( !SOLVER_TPL_FN(solverAssign)( pctx, cell, pc->val, SOLVER_REASON_NAKED ) )
+                return 0;
+        }
+
+        if( pctx->unit_dirty == 0 )
+        {
+            if( pctx->level > SOLVER_LEVEL_SINGLES )
+            {
+                unsigned int mark = pctx->backtrack_stack_top;
+
+                if( !SOLVER_TPL_FN(solverTiers)( pctx ) )
+                    return 0;
+
+                if( pctx->backtrack_stack_top != mark )
+                    continue;
+            }
+            pctx->queue_head = 0;
+            pctx->queue_tail = 0;
+            return 1;
+        }
+
+        unsigned int          unit   = SOLVER_CTZ64( pctx->unit_dirty );
+        const unsigned char * pcells = solver_unit_cells[SOLVER_TPL_N][unit];
+
+        pctx->unit_dirty &= pctx->unit_dirty - 1;
+
+        unsigned int once  = 0;
+        unsigned int twice = 0;
+
+        for( unsigned int i=0; i<SOLVER_TPL_NN; i++ )
+        {
+            const SOLVER_CANDITATE_S * pc = &pctx->candidate_array[pcells[i]];
+
+            if( pc->set == 0 )
+            {
+                twice |= once & pc->val;
+                once  |= pc->val;
+            }
+        }
+
+        if( SOLVER_TPL_FULL & ~(once | pctx->unit_used[unit]) )
+        {
+            solverConflict( pctx, SOLVER_CONFLICT_UNIT, unit, SOLVER_CTZ32( SOLVER_TPL_FULL & ~(once | pctx->unit_used[unit]) ) );
+            return 0;
+        }
+
+        unsigned int hidden = once & ~twice;
+
+        while( hidden != 0 )
+        {
+            unsigned int value = hidden & -hidden;
+            unsigned int i     = 0;
+
+            hidden &= hidden - 1;
+
+            while( i < SOLVER_TPL_NN &&
+                   (pctx->candidate_array[pcells[i]].set != 0 ||
+                   (pctx->candidate_array[pcells[i]].val & value) == 0) )
+            {
+                i++;
+            }
+
+            if( i == SOLVER_TPL_NN )
+            {
+                solverConflict( pctx, SOLVER_CONFLICT_UNIT, unit, SOLVER_CTZ32( value ) );
+                return 0; /* Its only cell took another hidden single from this unit */
+            }
+
+            SOLVER_TRACE_EVENT( pctx, SOLVER_TRACE_ASSIGN, pcells[i], value );
+
+            if( !SOLVER_TPL_FN(solverAssign)( pctx, pcells[i], value, unit ) )
+                return 0;
+        }
+    }
+}
+
+static int SOLVER_TPL_FN(solverProbe)( SOLVER_CTX_S * pctx, unsigned int cell )
+{
+    /*
+    ** Failed literal probing. Tries each value of the cell in turn, propagates, and undoes it
+    ** again. Values that lead straight to a contradiction are then removed from the cell, which
+    ** is propagated in turn. Returns zero if no value of the cell survives, or if the backtracking
+    ** stack is exhausted.
+    */
+    SOLVER_CANDITATE_S * pc     = &pctx->candidate_array[cell];
+    unsigned int         mark   = pctx->backtrack_stack_top;
+    unsigned int         failed = 0;
+
+    for( unsigned int m=pc->val; m!=0; m&=m-1 )
+    {
+        unsigned int value = m & -m;
+
+        SOLVER_STAT_ADD( pctx, probes, 1 );
+        SOLVER_TRACE_EVENT( pctx, SOLVER_TRACE_DECIDE, cell, value );
+
+        int ok = SOLVER_TPL_FN(solverAssign)( pctx, cell, value, SOLVER_REASON_DECISION ) && SOLVER_TPL_FN(solverPropagate)( pctx );
+
+        SOLVER_TPL_FN(solverUndo)( pctx, mark );
+        SOLVER_TRACE_EVENT( pctx, SOLVER_TRACE_BACKTRACK, pctx->decision_stack_top, 0 );
+
+        if( pctx->exhausted )
+            return 0;
+
+        if( !ok )
+            failed |= value;
+    }
+
+    if( failed == 0 )
+        return 1;
+
+    return SOLVER_TPL_FN(solverEliminate)( pctx, cell, failed, SOLVER_CAUSE_LEVEL | pctx->decision_stack_top ) &&
+           SOLVER_TPL_FN(solverPropagate)( pctx );
+}
+
+struct SOLVER_TPL_FN(_SOLVER_ANALYSIS_S)
+{
+    unsigned short lit[ SOLVER_NOGOOD_MAX_LITS ];
+    unsigned int   count;     /* Literals kept, with room left at lit[0] for the one at the conflict's depth */
+    unsigned int   overflow;  /* Set if there were more literals than fit */
+    unsigned int   pending;   /* Literals at the conflict's depth still to be followed back */
+    unsigned int   back;      /* Deepest decision of the literals kept, where the search jumps back to */
+    unsigned int   back_at;   /* Index of that literal in lit */
+    unsigned char  touched[ SOLVER_TPL_CELLS ];
+    unsigned int   touched_count;
+};
+typedef struct SOLVER_TPL_FN(_SOLVER_ANALYSIS_S) SOLVER_TPL_FN(SOLVER_ANALYSIS_S);
+
+static void SOLVER_TPL_FN(solverAnalysisAdd)( SOLVER_CTX_S * pctx, SOLVER_TPL_FN(SOLVER_ANALYSIS_S) * pa, unsigned int cell )
+{
+    /*
+    ** Adds the placement in cell to the nogood being built. Placements made before the first
+    ** decision hold for every solution, so they are left out.
+    */
+    unsigned int level = pctx->assign_level[cell];
+
+    if( level == 0 || pctx->plearn->seen[cell] )
+        return;
+
+    pctx->plearn->seen[cell] = 1;
+    pa->touched[pa->touched_count++] = cell;
+
+    if( level == pctx->decision_stack_top )
+    {
+        pa->pending++;
+        return;
+    }
+
+    if( level > pa->back )
+    {
+        pa->back    = level;
+        pa->back_at = pa->count;
+    }
+
+    if( pa->count < SOLVER_NOGOOD_MAX_LITS )
+        pa->lit[pa->count++] = SOLVER_LIT( cell, SOLVER_CTZ32( pctx->candidate_array[cell].set ) );
+    else
+        pa->overflow = 1;
+}
+
+static void SOLVER_TPL_FN(solverAnalysisCause)( SOLVER_CTX_S * pctx, SOLVER_TPL_FN(SOLVER_ANALYSIS_S) * pa, unsigned int cell, unsigned int vi )
+{
+    /*
+    ** Adds the placements that pruned value vi from cell.
+    */
+    unsigned int cause = pctx->prune_cause[cell][vi];
+
+    if( cause == SOLVER_CAUSE_NONE )
+        return;
+
+    if( cause & SOLVER_CAUSE_LEVEL )
+    {
+        for( unsigned int d=0; d<(cause & ~SOLVER_CAUSE_LEVEL); d++ )
+            SOLVER_TPL_FN(solverAnalysisAdd)( pctx, pa, pctx->decision_stack[d].cand );
+    }
+    else if( cause & SOLVER_CAUSE_NOGOOD )
+    {
+        const SOLVER_NOGOOD_S * png = &pctx->plearn->nogood[cause & ~SOLVER_CAUSE_NOGOOD];
+
+        for( unsigned int k=0; k<png->count; k++ )
+        {
+            if( png->lit[k] != SOLVER_LIT( cell, vi ) )
+                SOLVER_TPL_FN(solverAnalysisAdd)( pctx, pa, png->lit[k] >> 4 );
+        }
+    }
+    else
+    {
+        SOLVER_TPL_FN(solverAnalysisAdd)( pctx, pa, cause );
+    }
+}
+
+static unsigned int SOLVER_TPL_FN(solverAnalyze)( SOLVER_CTX_S * pctx, SOLVER_TPL_FN(SOLVER_ANALYSIS_S) * pa )
+{
+    /*
+    ** Builds a nogood from the last conflict, and returns its literal at the current depth.
+    **
+    ** Starting from the placements that directly caused the conflict, each placement made at the
+    ** current depth is replaced by the placements that caused it, latest first, until only one is
+    ** left. That one is the first unique implication point: on its own it leads to the conflict,
+    ** given the placements from earlier decisions. Those earlier placements are left in pa.
+    */
+    SOLVER_LEARN_S * pl = pctx->plearn;
+
+    pa->count         = 1;
+    pa->overflow      = 0;
+    pa->pending       = 0;
+    pa->back          = 0;
+    pa->back_at       = 0;
+    pa->touched_count = 0;
+
+    if( pctx->conflict_kind == SOLVER_CONFLICT_CELL )
+    {
+        for( unsigned int vi=0; vi<SOLVER_TPL_NN; vi++ )
+            SOLVER_TPL_FN(solverAnalysisCause)( pctx, pa, pctx->conflict_at, vi );
+    }
+    else if( pctx->conflict_kind == SOLVER_CONFLICT_UNIT )
+    {
+        const unsigned char * pcells = solver_unit_cells[SOLVER_TPL_N][pctx->conflict_at];
+
+        for( unsigned int i=0; i<SOLVER_TPL_NN; i++ )
+        {
+            if( pctx->candidate_array[pcells[i]].set != 0 )
+                SOLVER_TPL_FN(solverAnalysisAdd)( pctx, pa, pcells[i] );
+            else
+                SOLVER_TPL_FN(solverAnalysisCause)( pctx, pa, pcells[i], pctx->conflict_vi );
+        }
+    }
+    else
+    {
+        const SOLVER_NOGOOD_S * png = &pl->nogood[pctx->conflict_vi];
+
+        for( unsigned int k=0; k<png->count; k++ )
+            SOLVER_TPL_FN(solverAnalysisAdd)( pctx, pa, png->lit[k] >> 4 );
+    }
+
+    if( pa->pending == 0 )
+    {
+        /*
+        ** Nothing placed at this depth took part, as when a value pruned with
+        ** SOLVER_CAUSE_LEVEL fails straight away. Blaming the decision as well keeps the nogood
+        ** sound.
+        */
+        SOLVER_TPL_FN(solverAnalysisAdd)( pctx, pa, pctx->decision_stack[pctx->decision_stack_top-1].cand );
+    }
+
+    unsigned int uip  = 0;
+    unsigned int mark = pctx->decision_stack[pctx->decision_stack_top-1].mark;
+
+    for( unsigned int index=pctx->backtrack_stack_top; index-->mark; )
+    {
+        SOLVER_BACKTRACK_S bt = solverTrailAt( pctx, index );
+
+        if( (bt.row & SOLVER_BACKTRACK_ASSIGN) == 0 )
+            continue;
+
+        unsigned int cell = bt.row & ~SOLVER_BACKTRACK_ASSIGN;
+
+        if( !pl->seen[cell] )
+            continue;
+
+        unsigned int reason = pctx->assign_reason[cell];
+
+        uip = cell;
+
+        if( pa->pending == 1 || reason == SOLVER_REASON_DECISION )
+            break;
+
+        pa->pending--;
+
+        unsigned int vi = SOLVER_CTZ32( pctx->candidate_array[cell].set );
+
+        if( reason == SOLVER_REASON_NAKED )
+        {
+            for( unsigned int other=0; other<SOLVER_TPL_NN; other++ )
+            {
+                if( other != vi )
+                    SOLVER_TPL_FN(solverAnalysisCause)( pctx, pa, cell, other );
+            }
+        }
+        else
+        {
+            /*
+            ** A hidden single: every other cell of the unit was either placed first or had
+            ** lost the value.
+            */
+            const unsigned char * pcells = solver_unit_cells[SOLVER_TPL_N][reason];
+
+            for( unsigned int i=0; i<SOLVER_TPL_NN; i++ )
+            {
+                unsigned int peer = pcells[i];
+
+                if( peer == cell )
+                    continue;
+
+                if( pctx->candidate_array[peer].set != 0 && pctx->assign_pos[peer] < pctx->assign_pos[cell] )
+                    SOLVER_TPL_FN(solverAnalysisAdd)( pctx, pa, peer );
+                else
+                    SOLVER_TPL_FN(solverAnalysisCause)( pctx, pa, peer, vi );
+            }
+        }
+    }
+
+    for( unsigned int t=0; t<pa->touched_count; t++ )
+        pl->seen[pa->touched[t]] = 0;
+
+    pa->lit[0] = SOLVER_LIT( uip, SOLVER_CTZ32( pctx->candidate_array[uip].set ) );
+    return uip;
+}
+
+static int SOLVER_TPL_FN(solverLearn)( SOLVER_CTX_S * pctx )
+{
+    /*
+    ** Learns from the conflict the search has just run into. The nogood is kept, and the search
+    ** jumps back past every decision that played no part in it, to the deepest one that did. With
+    ** the rest of the nogood placed again there, its literal from the conflict is pruned, and
+    ** the search carries on from that point. A pruned value can lead to another conflict, which is
+    ** learned from in turn.
+    **
+    ** Returns zero if a conflict comes back to before the first decision, in which case the board
+    ** has no solution, or if the backtracking stack is exhausted.
+    */
+    SOLVER_TPL_FN(SOLVER_ANALYSIS_S) analysis;
+
+    while( pctx->decision_stack_top != 0 && !pctx->exhausted )
+    {
+        unsigned int uip   = SOLVER_TPL_FN(solverAnalyze)( pctx, &analysis );
+        unsigned int value = pctx->candidate_array[uip].set;
+        unsigned int cause = SOLVER_CAUSE_LEVEL | analysis.back;
+
+        if( !analysis.overflow && analysis.count >= 2 )
+        {
+            /*
+            ** Watch the literal at the conflict's depth and the deepest of the others, the first two
+            ** to be undone by backtracking.
+            */
+            unsigned short lit = analysis.lit[1];
+
+            analysis.lit[1] = analysis.lit[analysis.back_at];
+            analysis.lit[analysis.back_at] = lit;
+
+            unsigned int g = solverNogoodAdd( pctx, analysis.lit, analysis.count );
+
+            if( g != SOLVER_NOGOOD_NONE )
+                cause = SOLVER_CAUSE_NOGOOD | g;
+        }
+
+        SOLVER_STAT_ADD( pctx, backjumps, pctx->decision_stack_top - analysis.back - 1 );
+        SOLVER_TRACE_EVENT( pctx, SOLVER_TRACE_BACKTRACK, analysis.back, 0 );
+
+        pctx->decision_stack_top = analysis.back;
+        SOLVER_TPL_FN(solverUndo)( pctx, pctx->decision_stack[analysis.back].mark );
+
+        if( SOLVER_TPL_FN(solverEliminate)( pctx, uip, value, cause ) && SOLVER_TPL_FN(solverPropagate)( pctx ) )
+            return 1;
+    }
+    return 0;
+}
+
+static unsigned int SOLVER_TPL_FN(solverUnitPick)( const SOLVER_CTX_S * pctx, unsigned int num )
+{
+    /*
+    ** Looks for a value with fewer than num places left in one of its units. Returns the one with
+    ** the fewest as (unit << 4) | value index, or SOLVER_DECISION_CELL if there is none. Once
+    ** propagation is done no value has fewer than two places, so the first pair found is taken.
+    */
+    unsigned int best   = SOLVER_DECISION_CELL;
+    unsigned int fewest = num;
+
+    for( unsigned int unit=0; unit<SOLVER_TPL_UNITS; unit++ )
+    {
+        for( unsigned int open=SOLVER_TPL_FULL & ~pctx->unit_used[unit]; open!=0; open&=open-1 )
+        {
+            unsigned int vi     = SOLVER_CTZ32( open );
+            unsigned int places = SOLVER_POPCOUNT32( pctx->unit_where[unit][vi] );
+
+            if( places < fewest )
+            {
+                fewest = places;
+                best   = (unit << 4) | vi;
+
+                if( places <= 2 )
+                    return best;
+            }
+        }
+    }
+    return best;
+}
+
+static int SOLVER_TPL_FN(solverSearch)( SOLVER_CTX_S * pctx, int resume )
+{
+    /*
+    ** Depth first search over the open cells.
+    ** Each value tried is followed by propagation, and a failure at any point undoes back to
+    ** the decision's mark and moves on to the decision's next value.
+    **
+    ** The search always branches on an open cell with the fewest values left, taken from the
+    ** lowest non-empty bucket. Propagation has already placed every cell with one value, so this
+    ** is normally a cell with two.
+    **
+    ** With probing on, a cell with few enough values is probed before it becomes a decision. If
+    ** that removes any values the cell is chosen again, since a different one may now have fewer,
+    ** and if it removes them all the decision above has failed.
+    **
+    ** When every open cell has three or more values left, a value with fewer places left in one of
+    ** its units makes for a smaller branch. The decision then tries each of those places in turn.
+    **
+    ** With restarts on, the cell and the order of its values are partly random, and the search
+    ** goes back to the top whenever solverPoll says a restart is due.
+    **
+    ** When resume is set the search carries on from the solution it last returned, by moving
+    ** straight on to the next value of the last decision. This is how further solutions are found.
+    */
+    int descend = !resume;
+
+    if( resume && pctx->decision_stack_top == 0 )
+        return SOLVER_NO_SOLUTION; /* The last solution needed no decisions, so it is the only one */
+
+    for( ;; )
+    {
+        if( descend )
+        {
+            if( pctx->bucket_mask == 0 )
+            {
+                /*
+                ** Carrying on from here must not skip or repeat solutions, so there are no more
+                ** restarts or backjumps. Values already pruned by nogoods stay pruned, which is
+                ** safe since every nogood holds for the board.
+                */
+                pctx->found      = 1;
+                pctx->learning   = 0;
+                pctx->restart_at = 0;
+                return SOLVER_SOLVED;
+            }
+
+            if( pctx->ptable != NULL )
+            {
+                if( solverTableFind( pctx->ptable, pctx->hash ) )
+                {
+                    SOLVER_STAT_ADD( pctx, table_hits, 1 );
+                    SOLVER_STAT_ADD( pctx, backtracks, 1 );
+                    SOLVER_TRACE_EVENT( pctx, SOLVER_TRACE_BACKTRACK, pctx->decision_stack_top, 0 );
+
+                    if( pctx->decision_stack_top == 0 )
+                        return SOLVER_NO_SOLUTION;
+
+                    descend = 0;
+                    continue;
+                }
+                SOLVER_STAT_ADD( pctx, table_misses, 1 );
+            }
+
+            unsigned int cell;
+
+            if( pctx->restart_base != 0 )
+                cell = solverBucketPick( pctx );
+            else
+                cell = pctx->bucket_next[SOLVER_BUCKET_HEAD( SOLVER_CTZ32( pctx->bucket_mask ) )];
+
+            if( pctx->candidate_array[cell].num <= pctx->probe_max )
+            {
+                unsigned int mark = pctx->backtrack_stack_top;
+                uint64_t     hash = pctx->hash;
+
+                if( !SOLVER_TPL_FN(solverProbe)( pctx, cell ) )
+                {
+                    if( pctx->exhausted )
+                        return SOLVER_EXHAUSTED;
+
+                    solverTableNote( pctx, hash );
+
+                    SOLVER_STAT_ADD( pctx, backtracks, 1 );
+                    SOLVER_TRACE_EVENT( pctx, SOLVER_TRACE_BACKTRACK, pctx->decision_stack_top, 0 );
+
+                    if( pctx->decision_stack_top == 0 )
+                        return SOLVER_NO_SOLUTION;
+
+                    descend = 0;
+                    continue;
+                }
+
+                if( pctx->backtrack_stack_top != mark )
+                    continue;
+            }
+
+            unsigned int unit = SOLVER_DECISION_CELL;
+            unsigned int rem  = pctx->candidate_array[cell].val;
+
+            if( pctx->candidate_array[cell].num > 2 )
+            {
+                unit = SOLVER_TPL_FN(solverUnitPick)( pctx, pctx->candidate_array[cell].num );
+
+                if( unit != SOLVER_DECISION_CELL )
+                    rem = pctx->unit_where[unit >> 4][unit & 15];
+            }
+
+            pctx->decision_stack[pctx->decision_stack_top].cand = cell;
+            pctx->decision_stack[pctx->decision_stack_top].rem  = rem;
+            pctx->decision_stack[pctx->decision_stack_top].mark = pctx->backtrack_stack_top;
+            pctx->decision_stack[pctx->decision_stack_top].unit = unit;
+            pctx->decision_stack_top++;
+
+#if SOLVER_STATS
+            unsigned int depth = pctx->decision_stack_top - 1;
+
+            if( depth >= SOLVER_STATS_DEPTHS )
+                depth = SOLVER_STATS_DEPTHS - 1;
+
+            SOLVER_STAT_ADD( pctx, decisions[depth], 1 );
+            SOLVER_STAT_ADD( pctx, branches[depth], SOLVER_POPCOUNT32( rem ) );
+            SOLVER_STAT_MAX( pctx, depth_peak, pctx->decision_stack_top );
+#endif
+
+            descend = 0;
+        }
+
+        SOLVER_DECISION_S * pd = &pctx->decision_stack[pctx->decision_stack_top-1];
+
+        SOLVER_TPL_FN(solverUndo)( pctx, pd->mark );
+
+        if( pd->rem == 0 )
+        {
+            /*
+            ** All candidate values have been searched, so backtrack to the previous decision.
+            */
+            solverTableNote( pctx, pctx->hash );
+
+            SOLVER_STAT_ADD( pctx, backtracks, 1 );
+            SOLVER_TRACE_EVENT( pctx, SOLVER_TRACE_BACKTRACK, pctx->decision_stack_top - 1, 0 );
+
+            if( --pctx->decision_stack_top == 0 )
+                return SOLVER_NO_SOLUTION;
+            continue;
+        }
+
+        if( pctx->poll_nodes >= pctx->poll_next )
+        {
+            /*
+            ** Stopping here, before the next value is taken, leaves the search exactly where a
+            ** resumed search would carry on from.
+            */
+            int stop = solverPoll( pctx );
+
+            if( stop == SOLVER_POLL_RESTART )
+            {
+                /*
+                ** Back to before the first decision, keeping whatever was learned on the way.
+                */
+                SOLVER_TPL_FN(solverUndo)( pctx, pctx->decision_stack[0].mark );
+                pctx->decision_stack_top = 0;
+
+                SOLVER_STAT_ADD( pctx, restarts, 1 );
+                SOLVER_TRACE_EVENT( pctx, SOLVER_TRACE_BACKTRACK, 0, 0 );
+
+                descend = 1;
+                continue;
+            }
+
+            if( stop != 0 )
+                return stop;
+        }
+        pctx->poll_nodes++;
+
+        unsigned int choice = pd->rem & -pd->rem;
+
+        if( pctx->restart_base != 0 )
+        {
+            /*
+            ** Restarts only help if each run of the search takes a different path.
+            */
+            unsigned int rest = pd->rem;
+            unsigned int skip = solverRandom( pctx ) % SOLVER_POPCOUNT32( rest );
+
+            while( skip-- != 0 )
+                rest &= rest - 1;
+
+            choice = rest & -rest;
+        }
+
+        pd->rem &= ~choice;
+
+        unsigned int value = choice;
+
+        if( pd->unit != SOLVER_DECISION_CELL )
+        {
+            pd->cand = solver_unit_cells[SOLVER_TPL_N][pd->unit >> 4][SOLVER_CTZ32( choice )];
+            value    = 1u << (pd->unit & 15);
+        }
+
+        SOLVER_STAT_ADD( pctx, nodes, 1 );
+        SOLVER_TRACE_EVENT( pctx, SOLVER_TRACE_DECIDE, pd->cand, value );
+
+        if( SOLVER_TPL_FN(solverAssign)( pctx, pd->cand, value, SOLVER_REASON_DECISION ) && SOLVER_TPL_FN(solverPropagate)( pctx ) )
+            descend = 1;
+        else if( pctx->exhausted )
+            return SOLVER_EXHAUSTED;
+        else
+        {
+            SOLVER_STAT_ADD( pctx, backtracks, 1 );
+
+            if( pctx->restart_base != 0 )
+            {
+                pctx->conflicts[pd->cand]++;
+
+                if( pctx->conflict_kind == SOLVER_CONFLICT_CELL )
+                    pctx->conflicts[pctx->conflict_at]++;
+            }
+
+            if( pctx->learning )
+            {
+                if( !SOLVER_TPL_FN(solverLearn)( pctx ) )
+                    return pctx->exhausted ? SOLVER_EXHAUSTED : SOLVER_NO_SOLUTION;
+
+                descend = 1;
+            }
+            else
+                SOLVER_TRACE_EVENT( pctx, SOLVER_TRACE_BACKTRACK, pctx->decision_stack_top, 0 );
+        }
+    }
+}
+
+#undef SOLVER_TPL_FN
+#undef SOLVER_TPL_NN
+#undef SOLVER_TPL_CELLS
+#undef SOLVER_TPL_UNITS
+#undef SOLVER_TPL_PEERS
+#undef SOLVER_TPL_FULL
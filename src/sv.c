@@ -2,12 +2,16 @@
 ** Main implementation for the solver app.
 */
 
+#include <pthread.h>
+#include <stdatomic.h>
+
 #include "sw_def.h"
 #include "sw_dbg.h"
 #include "sw_spr.h"
 #include "sw_gfx.h"
 #include "sw_anm.h"
 #include "sw_msg.h"
+#include "sw_app_msg.h"
 
 #include "sv.h"
 
@@ -60,11 +64,31 @@ enum
     SV_RTA_COUNT = SV_RTA_PEG_LABEL_FIRST + SV_RTA_PEG_LABEL_COUNT
 };
 
+#define SV_SOLVE_TIME_LIMIT_NS 10000000000ull
+        /*
+        ** Boards entered by hand can be unsolvable in ways that take the solver a long time to
+        ** prove, so a solve is given up after ten seconds, if the user has not cancelled it first.
+        */
+
+#ifndef SV_SOLVE_THREADED
+#define SV_SOLVE_THREADED 1
+#endif
+#define SV_SOLVE_STEP_US 4000
+        /*
+        ** Boards are solved on a worker thread. Builds for targets where threads are not
+        ** available or not wanted can define SV_SOLVE_THREADED as 0, and the board is then solved
+        ** on the UI thread, 4 ms at a time, once per frame. The same happens if the thread cannot
+        ** be started.
+        */
+
 static SW_MSG_ID sv_msg_as[] =
 {
+    SW_MSG_PROCESS,
     SW_MSG_TOUCH,
     SW_MSG_TOUCH_UP,
     SW_MSG_TOUCH_MOVE,
+    SW_MSG_BACK,
+    SW_MSG_SOLVE_COMPLETE,
     SW_MSG_NONE
 };
 
@@ -93,6 +117,7 @@ enum
     SV_STATE_CREATE,
     SV_STATE_SUBMIT,
     SV_STATE_SOLVE,
+    SV_STATE_SOLVE_PENDING,
     SV_STATE_SOLVE_ANIMATED,
     SV_STATE_SOLVE_COMPLETE,
     SV_STATE_DRAG_PEG,
@@ -121,6 +146,27 @@ static float    sv_hit_a[SV_HIT_COUNT][4] = {0};
 
 static SUDOKU_S sv_sudoku_s = {0};
 
+static SOLVER_CTX_S * sv_solver_ctx = NULL; /* Tracks the board in create mode, one peg at a time */
+
+static pthread_t      sv_solve_thread;
+static int            sv_solve_busy = 0;  /* Set from starting the worker until it is joined */
+static int            sv_solve_stepping = 0;
+static int            sv_solve_queued = 0; /* Set if Solve was pressed while a cancelled solve wound down */
+static unsigned int   sv_solve_steps;     /* Frames spent on a solve without a worker */
+static atomic_int     sv_solve_done;      /* Set by the worker once the result is ready */
+static atomic_int     sv_solve_cancel;
+static int            sv_solve_result;
+static SUDOKU_S       sv_solve_board;
+static SUDOKU_S       sv_solve_solution;
+static SOLVER_CTX_S * sv_solve_ctx = NULL;
+        /*
+        ** Background solve.
+        ** The worker only touches its own copy of the board, the solution and the context. The UI
+        ** thread leaves them alone until sv_solve_done is set, then joins the worker and posts
+        ** SW_MSG_SOLVE_COMPLETE. The message queue is not thread safe, so the worker never
+        ** posts it itself.
+        */
+
 static int sv_peg_lbl_r_a[] =
 {
     TEX_MAIN_IMG_peg_1_r_FIRST,
@@ -318,6 +364,9 @@ static void sv_Scene_Create( void )
     sudokuClear( &sv_sudoku_s );
     sv_sudoku_s.n = 3;
     
+    if( sv_solver_ctx )
+        solverEditStart( sv_solver_ctx, &sv_sudoku_s );
+    
     sv_state = SV_STATE_CREATE;
 }
 
@@ -418,23 +467,26 @@ static void sv_AnimateDelay( int delay )
     sv_rta_a[SV_RTA_DELAY] = swAnmStart( a, sv_spr_a[SV_SPR_PEG_FIRST] );
 }
 
-static void sv_Solve( void )
+static void sv_SolveComplete( int result )
 {
-    SUDOKU_S solution = {0};
-    
+    /*
+    ** Reveals the solution found by the background solve, unless the user has moved on.
+    */
     int delay = 0;
     
-    int result = solverSolve( &sv_sudoku_s, &solution );
-    if( result )
+    if( sv_state != SV_STATE_SOLVE_PENDING )
+        return;
+    
+    if( result == SOLVER_SOLVED )
     {
         for( int row=0; row<9; row++ )
         {
             for( int col=0; col<9; col++ )
             {
-                if( solution.board[row][col] > 0 )
+                if( sv_solve_solution.board[row][col] > 0 )
                 {
                     int peg = (row * 9) + col;
-                    int val = solution.board[row][col]-1;
+                    int val = sv_solve_solution.board[row][col]-1;
                     
                     swSprSetImage( sv_spr_a[SV_SPR_PEG_LABEL_FIRST+peg], tex_main_images[sv_peg_lbl_r_a[val]] );
                     swSprShow    ( sv_spr_a[SV_SPR_PEG_LABEL_FIRST+peg], 1 );
@@ -448,6 +500,191 @@ static void sv_Solve( void )
         sv_AnimateDelay( delay+30 );
         sv_state = SV_STATE_SOLVE_ANIMATED;
     }
+    else
+    {
+        swSprShow( sv_spr_a[SV_SPR_BTN_SOLVE], 1 );
+        sv_state = SV_STATE_SOLVE;
+    }
+}
+
+static void * sv_SolveThread( void * parg )
+{
+    SOLVER_OPTS_S opts;
+    
+    solverOptsInit( &opts );
+    opts.time_limit_ns = SV_SOLVE_TIME_LIMIT_NS;
+    opts.pcancel       = &sv_solve_cancel;
+    
+    sv_solve_result = solverSolveEx( sv_solve_ctx, &sv_solve_board, &sv_solve_solution, &opts );
+    
+    atomic_store( &sv_solve_done, 1 );
+    return NULL;
+}
+
+static void sv_SolveJoin( void )
+{
+    /*
+    ** Waits for the background solve to finish, if there is one.
+    */
+    if( sv_solve_busy )
+    {
+        pthread_join( sv_solve_thread, NULL );
+        sv_solve_busy = 0;
+    }
+}
+
+static void sv_SolveCancel( void )
+{
+    if( sv_solve_busy || sv_solve_stepping )
+        atomic_store( &sv_solve_cancel, 1 );
+    
+    sv_solve_queued = 0;
+}
+
+static int sv_SolveStep( void )
+{
+    /*
+    ** Moves a solve without a worker on by one frame's worth.
+    ** Returns SOLVER_IN_PROGRESS until the solve is over.
+    */
+    SUDOKU_S solution;
+    
+    if( atomic_load( &sv_solve_cancel ) )
+        return SOLVER_CANCELLED;
+    
+    if( (unsigned long long)++sv_solve_steps * SV_SOLVE_STEP_US * 1000ull > SV_SOLVE_TIME_LIMIT_NS )
+        return SOLVER_TIMEOUT;
+    
+    int result = solverStep( sv_solve_ctx, SV_SOLVE_STEP_US, &solution );
+    
+    if( result == SOLVER_SOLVED )
+    {
+        /*
+        ** The solution includes the initial values, which are already on show.
+        */
+        for( int row=0; row<9; row++ )
+        {
+            for( int col=0; col<9; col++ )
+            {
+                if( sv_solve_board.board[row][col] == 0 )
+                    sv_solve_solution.board[row][col] = solution.board[row][col];
+            }
+        }
+    }
+    return result;
+}
+
+static void sv_SolveStart( void )
+{
+    /*
+    ** Starts solving the board in the background, on a worker if there can be one.
+    */
+    sudokuClear( &sv_solve_solution );
+    sv_solve_board = sv_sudoku_s;
+    
+    atomic_store( &sv_solve_done, 0 );
+    atomic_store( &sv_solve_cancel, 0 );
+    
+#if SV_SOLVE_THREADED
+    if( pthread_create( &sv_solve_thread, NULL, sv_SolveThread, NULL ) == 0 )
+    {
+        sv_solve_busy = 1;
+        return;
+    }
+#endif
+    
+    solverStart( sv_solve_ctx, &sv_solve_board );
+    sv_solve_steps    = 0;
+    sv_solve_stepping = 1;
+}
+
+static void sv_Solve( void )
+{
+    /*
+    ** Solves the board in the background. The frame loop carries on as normal, and the
+    ** solution is revealed when SW_MSG_SOLVE_COMPLETE arrives. If a cancelled solve has not
+    ** wound down yet, sv_Process starts this one as soon as it has.
+    */
+    if( sv_solve_ctx == NULL )
+        return;
+    
+    swSprShow( sv_spr_a[SV_SPR_BTN_SOLVE], 0 );
+    sv_state = SV_STATE_SOLVE_PENDING;
+    
+    if( sv_solve_busy || sv_solve_stepping )
+    {
+        sv_solve_queued = 1;
+        return;
+    }
+    sv_SolveStart();
+}
+
+static void sv_Process( void )
+{
+    /*
+    ** Called once per frame. Hands the result of a finished background solve over to the UI
+    ** thread as a message, or moves on a solve that has no worker. A cancelled solve has no
+    ** result to hand over, since the user has moved on, and a solve queued behind it starts
+    ** once it is over.
+    */
+    if( sv_solve_busy && atomic_load( &sv_solve_done ) )
+    {
+        sv_SolveJoin();
+        
+        if( !atomic_load( &sv_solve_cancel ) )
+        {
+            SW_MSG_S sMsg = swMsgNull( SW_MSG_SOLVE_COMPLETE );
+            sMsg.nVal[0] = sv_solve_result;
+            swMsgSend( sMsg );
+        }
+    }
+    
+    if( sv_solve_stepping )
+    {
+        int result = sv_SolveStep();
+        
+        if( result != SOLVER_IN_PROGRESS )
+        {
+            sv_solve_stepping = 0;
+            
+            if( !atomic_load( &sv_solve_cancel ) )
+            {
+                SW_MSG_S sMsg = swMsgNull( SW_MSG_SOLVE_COMPLETE );
+                sMsg.nVal[0] = result;
+                swMsgSend( sMsg );
+            }
+        }
+    }
+    
+    if( sv_solve_queued && !sv_solve_busy && !sv_solve_stepping )
+    {
+        sv_solve_queued = 0;
+        sv_SolveStart();
+    }
+}
+
+static void sv_ColourPegs( void )
+{
+    /*
+    ** Shows each placed peg in red if its value appears again in its row, column or region, and
+    ** in blue otherwise. An edit can clear a clash as well as make one, so every peg is checked.
+    */
+    for( int peg=0; peg<SV_SPR_PEG_COUNT; peg++ )
+    {
+        int row = peg / 9;
+        int col = peg % 9;
+        int val = sv_sudoku_s.board[row][col];
+        
+        if( val > 0 )
+        {
+            int * plbl_a = sv_peg_lbl_b_a;
+            
+            if( sv_solver_ctx && solverConflicts( sv_solver_ctx, row, col ) )
+                plbl_a = sv_peg_lbl_r_a;
+            
+            swSprSetImage( sv_spr_a[SV_SPR_PEG_LABEL_FIRST+peg], tex_main_images[plbl_a[val-1]] );
+        }
+    }
 }
 
 static void sv_DropPeg( void )
@@ -462,14 +699,18 @@ static void sv_DropPeg( void )
     {
         if( swIsTouchingv(x, y, sv_hit_a[SV_HIT_PEG_FIRST+peg]) )
         {
-            swSprSetImage( sv_spr_a[SV_SPR_PEG_LABEL_FIRST+peg], tex_main_images[sv_peg_lbl_b_a[sv_peg]] );
-            swSprShow    ( sv_spr_a[SV_SPR_PEG_LABEL_FIRST+peg], 1 );
-            swSprShow    ( sv_spr_a[SV_SPR_PEG_FIRST+peg], 1 );
-            
             int row = peg / 9;
             int col = peg % 9;
             
             sv_sudoku_s.board[row][col] = sv_peg+1;
+            
+            if( sv_solver_ctx )
+                solverAssign( sv_solver_ctx, row, col, sv_peg+1 );
+            
+            swSprShow( sv_spr_a[SV_SPR_PEG_LABEL_FIRST+peg], 1 );
+            swSprShow( sv_spr_a[SV_SPR_PEG_FIRST+peg], 1 );
+            
+            sv_ColourPegs();
         }
     }
 }
@@ -524,6 +765,7 @@ static int sv_Touch( float x, float y )
             }
             break;
             
+        case SV_STATE_SOLVE_PENDING:
         case SV_STATE_SOLVE_COMPLETE:
             if( swIsTouchingv(x, y, sv_hit_a[SV_HIT_BACK]) )
             {
@@ -582,6 +824,15 @@ static int sv_TouchUp( float x, float y )
             }
             break;
             
+        case SV_STATE_SOLVE_PENDING:
+            if( swIsTouchingv(x, y, sv_hit_a[SV_HIT_BACK]) )
+            {
+                swSprSetOffs( sv_spr_a[SV_SPR_BTN_BACK], 0, 0 );
+                sv_SolveCancel();
+                sv_Scene_Main();
+            }
+            break;
+            
         case SV_STATE_SOLVE_COMPLETE:
             if( swIsTouchingv(x, y, sv_hit_a[SV_HIT_BACK]) )
             {
@@ -630,6 +881,22 @@ static int sv_MsgHandler( SW_MSG_S sMsgData )
 {
     switch( sMsgData.msg )
     {
+        case SW_MSG_PROCESS:
+            sv_Process();
+            return 0;
+            
+        case SW_MSG_SOLVE_COMPLETE:
+            sv_SolveComplete( sMsgData.nVal[0] );
+            return 1;
+            
+        case SW_MSG_BACK:
+            if( sv_state != SV_STATE_SOLVE_PENDING )
+                return 0;
+            
+            sv_SolveCancel();
+            sv_Scene_Main();
+            return 1;
+            
         case SW_MSG_TOUCH:
             return sv_Touch( sMsgData.fVal[0], sMsgData.fVal[1] );
             
@@ -656,6 +923,9 @@ void sv_Start()
     swSprGen( SV_SPR_COUNT, sv_spr_a );
     swAnmGen( SV_ANM_COUNT, sv_anm_a );
     
+    sv_solver_ctx = solverCtxCreate();
+    sv_solve_ctx  = solverCtxCreate();
+    
     sv_Reset();
     sv_Scene_Main();
     
@@ -666,6 +936,14 @@ void sv_Stop()
 {
     swMsgDetach( sv_msg_as, sv_MsgHandler );
     
+    sv_SolveCancel();
+    sv_SolveJoin();
+    
+    solverCtxDestroy( sv_solve_ctx );
+    solverCtxDestroy( sv_solver_ctx );
+    sv_solve_ctx  = NULL;
+    sv_solver_ctx = NULL;
+    
     swAnmDel( SV_ANM_COUNT, sv_anm_a );
     swSprDel( SV_SPR_COUNT, sv_spr_a );
     
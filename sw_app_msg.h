@@ -10,6 +10,11 @@ enum
 {
     SW_MSG_START_GAME = SW_MSG_ID_USER_START,
     SW_MSG_EXIT,
+    
+    SW_MSG_SOLVE_COMPLETE,
+        /*
+        ** A background solve has finished. nVal[0] holds the solver result.
+        */
 };
 
 #endif /* __SW_APP_MSG_H__ */
@@ -0,0 +1,537 @@
+/*
+** Command line front end for the solver.
+**
+** Solves boards read from a file, or from standard input, and prints each solution. Meant for
+** looking into solver performance on a desktop machine, away from the app. Build it from the top
+** of the repository with:
+**
+**   cc -O2 -std=gnu11 -Isrc -Isw -I. tools/solver_cli.c src/solver.c src/solver_bb.c \
+**      src/pool.c src/sudoku.c -lpthread -o solver_cli
+**
+** Each board is one line of n^4 characters, read row by row. '.' or '0' is a blank, '1' to '9'
+** are themselves and 'A' to 'G' are 10 to 16. Blank lines and lines starting with '#' are skipped.
+** The board size follows from the length of the line, so 9x9 and 16x16 boards can be mixed.
+**
+** Options:
+**
+**   -b prune|dlx|bitboard   Backend to use. The default is prune.
+**   -t threads              Worker threads for the batch. Zero uses one per processor.
+**   -s                      Print the statistics of each solve, and the totals at the end.
+**   -q                      Do not print the solutions.
+**   -l level                Propagation level for the prune backend, 0 to 3. See SOLVER_LEVEL.
+**   -m ms                   Give up on a board after this many milliseconds.
+**   -p max                  Probe decisions with at most max values before branching.
+**   -g nogoods              Learn from dead ends, keeping up to this many nogoods.
+**   -r base                 Restart the search on a Luby schedule, base values tried per unit.
+**   -S seed                 Seed for the random choices made with -r.
+**   -H mb                   Keep a transposition table of up to this many megabytes, shared by
+**                           every board and thread.
+**
+**                           With -H the boards are solved one at a time, so the -t threads go to
+**                           each board instead.
+**   -L                      Benchmark the propagation levels instead of solving. Every board is
+**                           solved at each level in turn, one at a time, and the time taken,
+**                           values tried and dead ends are printed for each level.
+**   -T file                 Record a trace of the searches in file. The boards are then solved
+**                           one at a time, on one thread.
+*/
+
+/*
+** PREREQUISITES
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "sudoku.h"
+#include "solver.h"
+
+
+/*
+** DEFINITIONS
+*/
+
+#define CLI_LINE_MAX 1024
+
+#define CLI_TRACE_MAX_BYTES (256u * 1024 * 1024)
+
+
+/*
+** LOCAL FUNCTIONS
+*/
+
+static int cliParseBoard( const char * line, SUDOKU_S * psudoku )
+{
+    /*
+    ** Reads a board from one line of input. Returns zero if the line is not a board.
+    */
+    size_t len = strcspn( line, "\r\n" );
+
+    unsigned int n = 0;
+
+    for( unsigned int size=1; size<=4; size++ )
+    {
+        if( len == size * size * size * size )
+            n = size;
+    }
+    if( n == 0 )
+        return 0;
+
+    unsigned int nn = n * n;
+
+    sudokuClear( psudoku );
+    psudoku->n = n;
+
+    for( unsigned int i=0; i<len; i++ )
+    {
+        char         c   = line[i];
+        unsigned int val = 0;
+
+        if( c >= '1' && c <= '9' )
+            val = c - '0';
+        else if( c >= 'A' && c <= 'G' )
+            val = 10 + (c - 'A');
+        else if( c >= 'a' && c <= 'g' )
+            val = 10 + (c - 'a');
+        else if( c != '.' && c != '0' )
+            return 0;
+
+        if( val > nn )
+            return 0;
+
+        psudoku->board[i / nn][i % nn] = val;
+    }
+    return 1;
+}
+
+static void cliPrintBoard( const SUDOKU_S * psudoku, const SUDOKU_S * solution )
+{
+    static const char digits[] = ".123456789ABCDEFG";
+
+    unsigned int nn = psudoku->n * psudoku->n;
+
+    for( unsigned int row=0; row<nn; row++ )
+    {
+        for( unsigned int col=0; col<nn; col++ )
+        {
+            unsigned int val = psudoku->board[row][col] ? psudoku->board[row][col] : solution->board[row][col];
+
+            putchar( digits[val <= 16 ? val : 0] );
+        }
+    }
+    putchar( '\n' );
+}
+
+static void cliPrintStats( const char * title, const SOLVER_STATS_S * pstats )
+{
+    fprintf( stderr, "%s: nodes %llu, assignments %llu, backtracks %llu, prunes %llu, probes %llu, trail peak %u, depth peak %u\n",
+        title, pstats->nodes, pstats->assignments, pstats->backtracks, pstats->prunes, pstats->probes,
+        pstats->trail_peak, pstats->depth_peak );
+
+    if( pstats->learned != 0 )
+        fprintf( stderr, "  learning: %llu nogoods, %llu decisions jumped\n", pstats->learned, pstats->backjumps );
+
+    if( pstats->restarts != 0 )
+        fprintf( stderr, "  restarts: %llu\n", pstats->restarts );
+
+    if( pstats->table_hits + pstats->table_misses != 0 )
+        fprintf( stderr, "  table: %llu hits, %llu misses, %llu stored\n",
+            pstats->table_hits, pstats->table_misses, pstats->table_stores );
+
+    fprintf( stderr, "  time: setup %llu ns, candidates %llu ns, sort %llu ns, search %llu ns\n",
+        pstats->setup_ns, pstats->candgen_ns, pstats->sort_ns, pstats->search_ns );
+
+    for( int d=0; d<SOLVER_STATS_DEPTHS; d++ )
+    {
+        if( pstats->decisions[d] != 0 )
+        {
+            fprintf( stderr, "  depth %2d%s: %llu decisions, %.2f values each\n",
+                d, d == SOLVER_STATS_DEPTHS - 1 ? "+" : " ", pstats->decisions[d],
+                (double)pstats->branches[d] / (double)pstats->decisions[d] );
+        }
+    }
+}
+
+static void cliAddStats( SOLVER_STATS_S * pto, const SOLVER_STATS_S * pfrom )
+{
+    pto->nodes       += pfrom->nodes;
+    pto->assignments += pfrom->assignments;
+    pto->backtracks  += pfrom->backtracks;
+    pto->prunes      += pfrom->prunes;
+    pto->probes      += pfrom->probes;
+    pto->learned     += pfrom->learned;
+    pto->backjumps   += pfrom->backjumps;
+    pto->restarts    += pfrom->restarts;
+
+    pto->table_hits   += pfrom->table_hits;
+    pto->table_misses += pfrom->table_misses;
+    pto->table_stores += pfrom->table_stores;
+
+    if( pfrom->trail_peak > pto->trail_peak )
+        pto->trail_peak = pfrom->trail_peak;
+    if( pfrom->depth_peak > pto->depth_peak )
+        pto->depth_peak = pfrom->depth_peak;
+
+    for( int d=0; d<SOLVER_STATS_DEPTHS; d++ )
+    {
+        pto->decisions[d] += pfrom->decisions[d];
+        pto->branches [d] += pfrom->branches [d];
+    }
+
+    pto->setup_ns   += pfrom->setup_ns;
+    pto->candgen_ns += pfrom->candgen_ns;
+    pto->sort_ns    += pfrom->sort_ns;
+    pto->search_ns  += pfrom->search_ns;
+}
+
+static int cliCompareNs( const void * pa, const void * pb )
+{
+    unsigned long long a = *(const unsigned long long *)pa;
+    unsigned long long b = *(const unsigned long long *)pb;
+
+    return (a > b) - (a < b);
+}
+
+static void cliPrintPercentiles( const SOLVER_STATS_S * pstats, size_t count )
+{
+    /*
+    ** Prints how the solve times of the boards are spread. A few very slow boards hardly move
+    ** the total, but show up plainly in p99 and max.
+    */
+    unsigned long long * ns = (unsigned long long *)malloc( (count ? count : 1) * sizeof(unsigned long long) );
+
+    if( ns == NULL || count == 0 )
+    {
+        free( ns );
+        return;
+    }
+
+    for( size_t b=0; b<count; b++ )
+        ns[b] = pstats[b].setup_ns + pstats[b].candgen_ns + pstats[b].sort_ns + pstats[b].search_ns;
+
+    qsort( ns, count, sizeof(unsigned long long), cliCompareNs );
+
+    fprintf( stderr, "  per board: median %.3f ms, p90 %.3f ms, p99 %.3f ms, max %.3f ms\n",
+        (double)ns[count / 2] / 1e6, (double)ns[(count * 90) / 100] / 1e6,
+        (double)ns[(count * 99) / 100] / 1e6, (double)ns[count - 1] / 1e6 );
+
+    free( ns );
+}
+
+static unsigned long long cliNowNs( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ((unsigned long long)ts.tv_sec * 1000000000ull) + (unsigned long long)ts.tv_nsec;
+}
+
+static void cliBenchLevels( const SUDOKU_S * psudoku, size_t count, const SOLVER_OPTS_S * popts )
+{
+    /*
+    ** Solves every board at each propagation level, and prints a line per level. A stronger level
+    ** does more work at each value tried, so it pays off where the drop in values tried and dead
+    ** ends more than makes up for it.
+    */
+    static const char * names[] = { "singles", "locked", "subsets", "fish" };
+
+    SOLVER_CTX_S * pctx = solverCtxCreate();
+    SUDOKU_S       solution;
+    SOLVER_OPTS_S  opts = *popts;
+
+    if( pctx == NULL )
+    {
+        fprintf( stderr, "could not start the solver\n" );
+        return;
+    }
+
+    opts.backend = SOLVER_BACKEND_PRUNE;
+    opts.threads = 1;
+
+    printf( "level          ms        nodes   backtracks       prunes  solved  stopped\n" );
+
+    for( int level=SOLVER_LEVEL_SINGLES; level<=SOLVER_LEVEL_FISH; level++ )
+    {
+        SOLVER_STATS_S total;
+        SOLVER_STATS_S stats;
+        size_t         solved  = 0;
+        size_t         stopped = 0;
+
+        memset( &total, 0, sizeof(total) );
+        opts.level = level;
+
+        unsigned long long start = cliNowNs();
+
+        for( size_t b=0; b<count; b++ )
+        {
+            solution.n = psudoku[b].n;
+
+            int result = solverSolveEx( pctx, &psudoku[b], &solution, &opts );
+
+            if( result == SOLVER_SOLVED )
+                solved++;
+            else if( result == SOLVER_TIMEOUT )
+                stopped++;
+
+            solverCtxStats( pctx, &stats );
+            cliAddStats( &total, &stats );
+        }
+
+        double ms = (double)(cliNowNs() - start) / 1e6;
+
+        printf( "%d %-8s %10.1f %12llu %12llu %12llu %7zu %8zu\n",
+            level, names[level], ms, total.nodes, total.backtracks, total.prunes, solved, stopped );
+    }
+    solverCtxDestroy( pctx );
+}
+
+static void cliUsage( void )
+{
+    fprintf( stderr, "usage: solver_cli [-b prune|dlx|bitboard] [-t threads] [-s] [-q] [-l level] [-m ms] [-p max] [-g nogoods] [-r base] [-S seed] [-H mb] [-L] [-T trace] [file]\n" );
+    exit( 2 );
+}
+
+
+/*
+** MAIN
+*/
+
+int main( int argc, char ** argv )
+{
+    SOLVER_OPTS_S opts;
+
+    int          threads = 1;
+    int          stats   = 0;
+    int          quiet   = 0;
+    int          bench   = 0;
+    const char * path    = NULL;
+    const char * trace   = NULL;
+    size_t       table   = 0;
+
+    solverOptsInit( &opts );
+
+    for( int a=1; a<argc; a++ )
+    {
+        if( strcmp( argv[a], "-b" ) == 0 && a+1 < argc )
+        {
+            a++;
+            if( strcmp( argv[a], "prune" ) == 0 )
+                opts.backend = SOLVER_BACKEND_PRUNE;
+            else if( strcmp( argv[a], "dlx" ) == 0 )
+                opts.backend = SOLVER_BACKEND_DLX;
+            else if( strcmp( argv[a], "bitboard" ) == 0 )
+                opts.backend = SOLVER_BACKEND_BITBOARD;
+            else
+                cliUsage();
+        }
+        else if( strcmp( argv[a], "-t" ) == 0 && a+1 < argc )
+            threads = atoi( argv[++a] );
+        else if( strcmp( argv[a], "-s" ) == 0 )
+            stats = 1;
+        else if( strcmp( argv[a], "-q" ) == 0 )
+            quiet = 1;
+        else if( strcmp( argv[a], "-l" ) == 0 && a+1 < argc )
+            opts.level = atoi( argv[++a] );
+        else if( strcmp( argv[a], "-m" ) == 0 && a+1 < argc )
+            opts.time_limit_ns = strtoull( argv[++a], NULL, 10 ) * 1000000ull;
+        else if( strcmp( argv[a], "-p" ) == 0 && a+1 < argc )
+            opts.probe_max = atoi( argv[++a] );
+        else if( strcmp( argv[a], "-g" ) == 0 && a+1 < argc )
+            opts.learn_max = atoi( argv[++a] );
+        else if( strcmp( argv[a], "-r" ) == 0 && a+1 < argc )
+            opts.restart_base = atoi( argv[++a] );
+        else if( strcmp( argv[a], "-S" ) == 0 && a+1 < argc )
+            opts.seed = strtoull( argv[++a], NULL, 10 );
+        else if( strcmp( argv[a], "-H" ) == 0 && a+1 < argc )
+            table = strtoull( argv[++a], NULL, 10 ) * 1024 * 1024;
+        else if( strcmp( argv[a], "-L" ) == 0 )
+            bench = 1;
+        else if( strcmp( argv[a], "-T" ) == 0 && a+1 < argc )
+            trace = argv[++a];
+        else if( argv[a][0] == '-' || path != NULL )
+            cliUsage();
+        else
+            path = argv[a];
+    }
+
+    FILE * pfile = path ? fopen( path, "r" ) : stdin;
+
+    if( pfile == NULL )
+    {
+        perror( path );
+        return 1;
+    }
+
+    /*
+    ** Read every board first, so the whole set can be handed to the batch solver at once.
+    */
+    SUDOKU_S * psudoku  = NULL;
+    size_t     count    = 0;
+    size_t     capacity = 0;
+    char       line[ CLI_LINE_MAX ];
+
+    while( fgets( line, sizeof(line), pfile ) != NULL )
+    {
+        if( line[0] == '#' || line[strspn( line, " \t\r\n" )] == '\0' )
+            continue;
+
+        if( count == capacity )
+        {
+            capacity = capacity ? capacity * 2 : 256;
+            psudoku  = (SUDOKU_S *)realloc( psudoku, capacity * sizeof(SUDOKU_S) );
+            if( psudoku == NULL )
+            {
+                fprintf( stderr, "out of memory\n" );
+                return 1;
+            }
+        }
+
+        if( cliParseBoard( line, &psudoku[count] ) )
+            count++;
+        else
+            fprintf( stderr, "skipping line that is not a board: %s", line );
+    }
+
+    if( pfile != stdin )
+        fclose( pfile );
+
+    if( bench )
+    {
+        cliBenchLevels( psudoku, count, &opts );
+        free( psudoku );
+        return 0;
+    }
+
+    SUDOKU_S *       solution = (SUDOKU_S *)calloc( count ? count : 1, sizeof(SUDOKU_S) );
+    int *            status   = (int *)calloc( count ? count : 1, sizeof(int) );
+    SOLVER_STATS_S * pstats   = (SOLVER_STATS_S *)calloc( count ? count : 1, sizeof(SOLVER_STATS_S) );
+
+    if( solution == NULL || status == NULL || pstats == NULL )
+    {
+        fprintf( stderr, "out of memory\n" );
+        return 1;
+    }
+
+    SOLVER_TRACE_S * ptrace = NULL;
+
+    if( trace != NULL )
+    {
+        ptrace = solverTraceCreate( CLI_TRACE_MAX_BYTES );
+        if( ptrace == NULL )
+        {
+            fprintf( stderr, "out of memory\n" );
+            return 1;
+        }
+    }
+
+    SOLVER_TABLE_S * ptable = NULL;
+
+    if( table != 0 )
+    {
+        ptable = solverTableCreate( table );
+        if( ptable == NULL )
+        {
+            fprintf( stderr, "out of memory\n" );
+            return 1;
+        }
+    }
+
+    if( ptrace == NULL && ptable == NULL )
+    {
+        if( solverSolveBatch( psudoku, solution, status, pstats, count, threads, &opts ) < 0 )
+        {
+            fprintf( stderr, "could not start the solver\n" );
+            return 1;
+        }
+    }
+    else
+    {
+        SOLVER_CTX_S * pctx = solverCtxCreate();
+
+        if( pctx == NULL )
+        {
+            fprintf( stderr, "could not start the solver\n" );
+            return 1;
+        }
+        solverCtxTrace( pctx, ptrace );
+        solverCtxTable( pctx, ptable );
+        opts.threads = (ptrace != NULL) ? 1 : threads; /* Parallel solves are not traced */
+
+        for( size_t b=0; b<count; b++ )
+        {
+            solution[b].n = psudoku[b].n;
+            status  [b]   = solverSolveEx( pctx, &psudoku[b], &solution[b], &opts );
+            solverCtxStats( pctx, &pstats[b] );
+        }
+        solverCtxDestroy( pctx );
+    }
+
+    SOLVER_STATS_S total;
+    size_t         solved = 0;
+
+    memset( &total, 0, sizeof(total) );
+
+    for( size_t b=0; b<count; b++ )
+    {
+        if( !quiet )
+        {
+            if( status[b] == SOLVER_SOLVED )
+                cliPrintBoard( &psudoku[b], &solution[b] );
+            else if( status[b] == SOLVER_EXHAUSTED )
+                printf( "exhausted\n" );
+            else if( status[b] == SOLVER_TIMEOUT )
+                printf( "stopped\n" );
+            else
+                printf( "no solution\n" );
+        }
+
+        if( status[b] == SOLVER_SOLVED )
+            solved++;
+
+        if( stats )
+        {
+            char title[ 32 ];
+
+            snprintf( title, sizeof(title), "board %zu", b + 1 );
+            cliPrintStats( title, &pstats[b] );
+            cliAddStats( &total, &pstats[b] );
+        }
+    }
+
+    if( stats )
+    {
+        cliPrintStats( "total", &total );
+        cliPrintPercentiles( pstats, count );
+    }
+
+    if( ptrace != NULL )
+    {
+        size_t                size;
+        const unsigned char * data   = solverTraceData( ptrace, &size );
+        unsigned long long    events = solverTraceEvents( ptrace );
+        FILE *                pout   = fopen( trace, "wb" );
+
+        if( pout == NULL || fwrite( data, 1, size, pout ) != size )
+            perror( trace );
+        if( pout != NULL )
+            fclose( pout );
+
+        fprintf( stderr, "trace: %llu events in %zu bytes, %.2f bytes per event%s\n",
+            events, size, events ? (double)size / (double)events : 0.0,
+            solverTraceTruncated( ptrace ) ? ", truncated" : "" );
+
+        solverTraceDestroy( ptrace );
+    }
+
+    solverTableDestroy( ptable );
+
+    fprintf( stderr, "%zu of %zu boards solved\n", solved, count );
+
+    free( pstats );
+    free( status );
+    free( solution );
+    free( psudoku );
+
+    return solved == count ? 0 : 1;
+}
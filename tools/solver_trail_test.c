@@ -0,0 +1,131 @@
+/*
+** Checks the limit on the backtracking stack.
+**
+** Includes solver.c directly, so it can push onto the stack of a context without a search. Build
+** and run it from the top of the repository with the default limit, and again with a limit that
+** is not a whole number of chunks:
+**
+**   cc -O2 -std=gnu11 -Isrc -Isw -I. tools/solver_trail_test.c src/solver_bb.c src/pool.c \
+**      src/sudoku.c -lpthread -o solver_trail_test && ./solver_trail_test
+**
+**   cc -O2 -std=gnu11 -DSOLVER_TRAIL_MAX_BYTES=5000 -Isrc -Isw -I. tools/solver_trail_test.c \
+**      src/solver_bb.c src/pool.c src/sudoku.c -lpthread -o solver_trail_test && ./solver_trail_test
+**
+** Prints each check, and exits with a non-zero status if any of them fails.
+*/
+
+/*
+** PREREQUISITES
+*/
+#include <stdio.h>
+
+#include "solver.c"
+
+
+/*
+** LOCAL VARIABLES
+*/
+
+static int trail_failed = 0;
+
+
+/*
+** LOCAL FUNCTIONS
+*/
+
+static void trailCheck( int ok, const char * what )
+{
+    printf( "%s: %s\n", ok ? "ok  " : "FAIL", what );
+
+    if( !ok )
+        trail_failed = 1;
+}
+
+static void trailFill( void )
+{
+    /*
+    ** Pushes entries until the stack is refused. Every entry up to SOLVER_TRAIL_MAX_ENTRIES must
+    ** fit, which for the default limit is the 17 entries per cell of a 16x16 board, and the one
+    ** after must not. The entries must read back as they were pushed.
+    */
+    SOLVER_CTX_S * pctx = solverCtxCreate();
+
+    if( pctx == NULL )
+    {
+        trailCheck( 0, "create a context" );
+        return;
+    }
+
+    unsigned int pushed = 0;
+
+    while( pushed <= SOLVER_TRAIL_MAX_ENTRIES && solverTrailPush( pctx, pushed % SOLVER_CANDIDATE_ARRAY_SIZE, 1u << (pushed % 16) ) )
+        pushed++;
+
+    printf( "      pushed %u of %u entries\n", pushed, (unsigned int)SOLVER_TRAIL_MAX_ENTRIES );
+
+    trailCheck( pushed == SOLVER_TRAIL_MAX_ENTRIES, "the stack holds exactly SOLVER_TRAIL_MAX_ENTRIES" );
+    trailCheck( pctx->exhausted, "the push past the limit marks the context exhausted" );
+    trailCheck( pctx->backtrack_stack_size == SOLVER_TRAIL_MAX_ENTRIES, "the chunks add up to the limit" );
+
+    int same = 1;
+
+    for( unsigned int i=0; i<pushed; i++ )
+    {
+        SOLVER_BACKTRACK_S bt = solverTrailAt( pctx, i );
+
+        if( bt.row != i % SOLVER_CANDIDATE_ARRAY_SIZE || bt.val != 1u << (i % 16) )
+            same = 0;
+    }
+    trailCheck( same, "every entry reads back as pushed" );
+
+    solverCtxDestroy( pctx );
+}
+
+static void trailSearch( void )
+{
+    /*
+    ** The empty 16x16 board places every cell along a single path, which is as deep as the stack
+    ** gets. It must solve within the default limit.
+    */
+    SOLVER_CTX_S * pctx = solverCtxCreate();
+    SUDOKU_S       board;
+    SUDOKU_S       solution;
+
+    if( pctx == NULL )
+    {
+        trailCheck( 0, "create a context" );
+        return;
+    }
+
+    sudokuClear( &board );
+    board.n  = 4;
+    solution = board;
+
+    int result = solverSolveCtx( pctx, &board, &solution );
+
+    size_t used = solverCtxTrailPeak( pctx ) / sizeof(SOLVER_BACKTRACK_S);
+
+    printf( "      empty 16x16 board used %zu entries\n", used );
+
+    if( SOLVER_TRAIL_MAX_ENTRIES >= SOLVER_CANDIDATE_ARRAY_SIZE * 17 )
+        trailCheck( result == SOLVER_SOLVED, "the empty 16x16 board solves" );
+    else
+        trailCheck( result == SOLVER_SOLVED || result == SOLVER_EXHAUSTED, "the empty 16x16 board solves or is exhausted" );
+
+    trailCheck( used <= SOLVER_TRAIL_MAX_ENTRIES, "the search stays within the limit" );
+
+    solverCtxDestroy( pctx );
+}
+
+
+/*
+** EXPORTED FUNCTIONS
+*/
+
+int main( void )
+{
+    trailFill();
+    trailSearch();
+
+    return trail_failed;
+}